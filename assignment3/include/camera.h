@@ -0,0 +1,17 @@
+/* this file contains the camera of the map
+    - viewport that follows the drone with zoom levels
+    - spatial index of the obstacles (buckets + summed area table)
+    - draw only the visible obstacles: the cost depends on the screen size, not on the obstacles
+*/
+
+#ifndef CAMERA_H
+#define CAMERA_H
+
+#include "map.h"
+
+void camera_update(Camera *c, const GameState *g, int view_w, int view_h);
+void camera_project(const Camera *c, double x, double y, int *col, int *row);
+void camera_draw_obstacles(const Camera *c, const GameState *g, WINDOW *win, int view_w, int view_h);
+void camera_free(Camera *c);
+
+#endif
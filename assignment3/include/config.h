@@ -0,0 +1,43 @@
+/* config.h
+    parameters.config parsed once by the blackboard and shared with the children (config.c)
+
+    - config_load: the only parser of the file (table of the keys, defaults first), used by the blackboard
+      at the start and by its reload thread
+    - shm /config: the blackboard publishes the Config before the fork, the children map it read-only
+      and copy it, no child opens or parses the file
+    - versioned: version 1 at the start, +1 for every reload applied by the blackboard; the children compare
+      the version to know when to copy it again
+    - seqlock around the publication (odd sequence while writing, the readers retry), like state_shm.h
+*/
+
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+#include "map.h"
+
+#define CONFIG_PATH "bin/parameters.config"
+#define CONFIG_SHM_NAME "/config"
+
+typedef struct {
+    _Atomic uint32_t seq; //seqlock sequence
+    _Atomic uint32_t version; //0: not published yet
+    Config cfg;
+} ConfigShm;
+
+int config_load(const char *path, Config *cfg); //defaults + values of the file, -1 if the file cannot be read (defaults only)
+int config_valid(const Config *cfg); //size, mass and dt set (a file saved half-written is not valid)
+
+ConfigShm *config_shm_create(void); //blackboard: create and map read/write (NULL on error)
+void config_publish(ConfigShm *shm, const Config *cfg); //blackboard: new version
+const ConfigShm *config_shm_open(void); //children: map read-only (NULL if the blackboard did not create it)
+uint32_t config_read(const ConfigShm *shm, Config *out); //consistent copy, return its version
+void config_shm_close(const ConfigShm *shm, int unlink_it);
+
+static inline uint32_t config_version(const ConfigShm *shm) {
+    return shm ? atomic_load_explicit(&shm->version, memory_order_acquire) : 0;
+}
+
+#endif
@@ -0,0 +1,49 @@
+/* config_reload.h
+    hot reload of parameters.config in the blackboard (config_reload.c)
+
+    - inotify on the directory of the file: a save in place (IN_CLOSE_WRITE) or a save by rename (IN_MOVED_TO)
+      both start a reload, the other files of the directory are ignored
+    - 'P' key and SIGUSR2 start the same reload
+    - the file is parsed by a reload thread, never in the event loop: the thread writes an eventfd when
+      the new Config is ready, the loop copies it and applies it at the next physics tick
+    - a reload requested while a parse is running is merged in one more parse
+*/
+
+#ifndef CONFIG_RELOAD_H
+#define CONFIG_RELOAD_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+#include "map.h"
+
+typedef int (*ConfigParser)(const char *path, Config *cfg); //config_load
+
+typedef struct {
+    int watch_fd; //inotify (-1: not available, 'P' and SIGUSR2 still work)
+    int ready_fd; //eventfd written by the thread when a Config is parsed
+    const char *path;
+    const char *file; //name of the file in its directory (inotify events)
+    ConfigParser parse;
+
+    pthread_t tid;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    int requested, stop, started;
+    Config parsed; //last parsed config (under lock)
+    uint64_t request_us, parse_us; //time of the request and duration of the parse
+} ConfigReload;
+
+int reload_start(ConfigReload *r, const char *path, ConfigParser parse);
+/* arguments
+    - path: config file (its directory is watched)
+    - parse: function that reads the file in a Config
+    return 0 when the thread is started
+*/
+
+void reload_request(ConfigReload *r, const char *why); //start a parse (SIGUSR2, 'P')
+int reload_watch(ConfigReload *r); //watch_fd ready: read the events, 1 if the config file changed (parse requested)
+int reload_take(ConfigReload *r, Config *out, uint64_t *request_us, uint64_t *parse_us); //ready_fd ready: 1 if a Config is copied
+void reload_stop(ConfigReload *r); //join the thread and close the fds
+
+#endif
@@ -2,15 +2,32 @@
     - compute the direction forces
     - compute the brake
     - compute the dynamics of the drone
+    - merge the commands received between two physics ticks (InputAccum)
 */
 
 #ifndef DRONE_PHYSICS_H
 #define DRONE_PHYSICS_H
 
+#include <stdint.h>
+
 #include "map.h"
 
+//commands received since the last physics tick
+typedef struct {
+    int mx, my; //sum of the directions
+    int brake; //at least one brake
+    int commands; //commands merged
+    uint64_t first_us; //arrival of the first command (now_us)
+} InputAccum;
+
 void add_direction(GameState *g, int mx, int my);
 void use_brake(GameState *g);
 void add_drone_dynamics(GameState *g);
 
+void input_accumulate(InputAccum *a, char type, int mx, int my, uint64_t now);
+int apply_input(GameState *g, InputAccum *a);
+/* input_accumulate stores a direction ('I') or a brake ('B'),
+   apply_input is called at the tick: brake first (once), then the summed direction,
+   returns the number of commands applied (0: nothing pending) and empties the accumulator */
+
 #endif
\ No newline at end of file
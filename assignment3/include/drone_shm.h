@@ -0,0 +1,166 @@
+/* drone_shm.h
+    shared memory object (shm) used when the drone process integrates the dynamics (PHYSICS_OWNER=drone)
+
+    - commands block, written only by the blackboard:
+        - commands as totals since the start (directions summed, brakes counted): the drone applies the difference,
+          so a command is never lost or applied twice, also if the drone reads it late
+        - environment of the integration: physics parameters, world size, obstacles
+    - result block, written only by the drone process after every step: drone position, velocity, forces, collision counters
+    - one seqlock for each block (odd sequence while writing, the reader copies and retries if it changed)
+    - the drone still sends its tick message: the blackboard wakes up, reads the result and checks the targets
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <sched.h>
+#include <stdatomic.h>
+
+#include "map.h"
+
+// POSIX shared memory name - blackboard (commands) and process_drone (result)
+#define DRONE_SHM_NAME "/drone_state"
+
+//blackboard -> drone
+typedef struct {
+  //commands until now
+  uint64_t commands; //merged commands (acknowledged in the result)
+  uint64_t brakes;
+  int64_t mx, my;
+
+  //environment
+  double mass, k, dt;
+  double rho, eta, zeta, tangent_gain;
+  double command_force, max_force;
+  int world_width, world_height;
+  int num_obstacles;
+  Obstacle obstacles[MAX_OBSTACLES];
+} DroneCommands;
+
+//drone -> blackboard
+typedef struct {
+  uint64_t steps; //integration steps until now
+  uint64_t commands; //commands applied until now
+  Drone drone;
+  double fx_cmd, fy_cmd;
+  double fx_obst, fy_obst, fx_fence, fy_fence, fx_tot, fy_tot;
+  int was_on_obstacles, was_on_fence;
+  int obstacles_hit_tot, fence_collision_tot; //the blackboard adds the difference to the score counters
+} DroneResult;
+
+typedef struct {
+  _Atomic uint32_t cmd_seq;
+  DroneCommands cmd;
+  _Alignas(64) _Atomic uint32_t res_seq; //other cache line: the two writers do not share it
+  DroneResult res;
+} DroneShm;
+
+
+//seqlock (one writer for each block)
+static inline void drone_seq_begin(_Atomic uint32_t *seq) {
+    uint32_t s = atomic_load_explicit(seq, memory_order_relaxed);
+    atomic_store_explicit(seq, s + 1, memory_order_relaxed); //odd -> readers retry
+    atomic_thread_fence(memory_order_release);
+}
+
+static inline void drone_seq_end(_Atomic uint32_t *seq) {
+    uint32_t s = atomic_load_explicit(seq, memory_order_relaxed);
+    atomic_store_explicit(seq, s + 1, memory_order_release); //even -> block consistent
+}
+
+static inline void drone_seq_read(_Atomic uint32_t *seq, void *out, const void *block, size_t len) {
+    for (int attempt = 0; ; attempt++) {
+        uint32_t s1 = atomic_load_explicit(seq, memory_order_acquire);
+        if (s1 & 1) { //write in progress
+            if (attempt > 100) sched_yield();
+            continue;
+        }
+        memcpy(out, block, len);
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(seq, memory_order_relaxed) == s1) return;
+    }
+}
+
+//blackboard: environment of the integration from the GameState (commands not changed)
+static inline void drone_publish_env(DroneShm *shm, const GameState *gs) {
+    drone_seq_begin(&shm->cmd_seq);
+    DroneCommands *c = &shm->cmd;
+    c->mass = gs->mass;
+    c->k = gs->k;
+    c->dt = gs->dt;
+    c->rho = gs->rho;
+    c->eta = gs->eta;
+    c->zeta = gs->zeta;
+    c->tangent_gain = gs->tangent_gain;
+    c->command_force = gs->command_force;
+    c->max_force = gs->max_force;
+    c->world_width = gs->world_width;
+    c->world_height = gs->world_height;
+    c->num_obstacles = gs->num_obstacles;
+    memcpy(c->obstacles, gs->obstacles, sizeof(c->obstacles));
+    drone_seq_end(&shm->cmd_seq);
+}
+
+//blackboard: add the commands of one batch
+static inline void drone_publish_commands(DroneShm *shm, int commands, int brake, int mx, int my) {
+    drone_seq_begin(&shm->cmd_seq);
+    shm->cmd.commands += commands;
+    shm->cmd.brakes += brake;
+    shm->cmd.mx += mx;
+    shm->cmd.my += my;
+    drone_seq_end(&shm->cmd_seq);
+}
+
+//drone: environment in the local GameState
+static inline void drone_env_to_state(GameState *gs, const DroneCommands *c) {
+    gs->mass = c->mass;
+    gs->k = c->k;
+    gs->dt = c->dt;
+    gs->rho = c->rho;
+    gs->eta = c->eta;
+    gs->zeta = c->zeta;
+    gs->tangent_gain = c->tangent_gain;
+    gs->command_force = c->command_force;
+    gs->max_force = c->max_force;
+    gs->world_width = c->world_width;
+    gs->world_height = c->world_height;
+    gs->num_obstacles = c->num_obstacles;
+    memcpy(gs->obstacles, c->obstacles, sizeof(gs->obstacles));
+}
+
+//drone-owned fields of the GameState <-> result block
+static inline void drone_result_from_state(DroneResult *r, const GameState *gs) {
+    r->drone = gs->drone;
+    r->fx_cmd = gs->fx_cmd;
+    r->fy_cmd = gs->fy_cmd;
+    r->fx_obst = gs->fx_obst;
+    r->fy_obst = gs->fy_obst;
+    r->fx_fence = gs->fx_fence;
+    r->fy_fence = gs->fy_fence;
+    r->fx_tot = gs->fx_tot;
+    r->fy_tot = gs->fy_tot;
+    r->was_on_obstacles = gs->was_on_obstacles;
+    r->was_on_fence = gs->was_on_fence;
+    r->obstacles_hit_tot = gs->obstacles_hit_tot;
+    r->fence_collision_tot = gs->fence_collision_tot;
+}
+
+static inline void drone_result_to_state(GameState *gs, const DroneResult *r) {
+    gs->obstacles_hit += r->obstacles_hit_tot - gs->obstacles_hit_tot; //new hits since the last result
+    gs->fence_collision += r->fence_collision_tot - gs->fence_collision_tot;
+
+    gs->drone = r->drone;
+    gs->fx_cmd = r->fx_cmd;
+    gs->fy_cmd = r->fy_cmd;
+    gs->fx_obst = r->fx_obst;
+    gs->fy_obst = r->fy_obst;
+    gs->fx_fence = r->fx_fence;
+    gs->fy_fence = r->fy_fence;
+    gs->fx_tot = r->fx_tot;
+    gs->fy_tot = r->fy_tot;
+    gs->was_on_obstacles = r->was_on_obstacles;
+    gs->was_on_fence = r->was_on_fence;
+    gs->obstacles_hit_tot = r->obstacles_hit_tot;
+    gs->fence_collision_tot = r->fence_collision_tot;
+}
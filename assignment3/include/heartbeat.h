@@ -3,44 +3,95 @@
     verified if the process is alive and active (not blocked / deadlocked)
 
     - POSIX shm -> map for each process
+    - registry of slots claimed at runtime: a process claims a free slot with its name, PID, expected heartbeat period
+      and its own timeout (0: timeout of the watchdog), so any number of workers (up to HB_MAX_SLOTS) can be watched
+      without a fixed list of processes; the blackboard claims first and always gets slot 0
     - each process updates its slot with:
-      - PID
       - monotonic timestamp (last_seen_ms) - monotonic for a more robust and deterministic timeout
+    - no lock: every slot has one writer (its process), pid and timestamp are atomic and every slot is on its own
+      cache line, so a heartbeat is one store and the watchdog reads without waiting anybody
+    - layout version written by the blackboard: a process built with another layout of the table refuses to start
     - watchdog checks the timestamps (IF not exist an answar: process is stuck)
+    - readiness barrier at the start (instead of fixed sleeps):
+      - every process sets the bit of its slot in ready_mask and posts 'ready' after it mapped the table and opened its channel
+      - the blackboard waits on 'ready' until all the processes it started are ready, then writes boot_mask
+      - the watchdog starts checking when boot_mask is written
+    - supervisor (RESTART_WORKERS > 0): the watchdog releases the slot of a worker that died or hung and sends
+      HB_SIG_RESTART to the blackboard with the HB_PROC_* of the worker, the blackboard starts only that worker again
+    - loop statistics (hb_loop): every process also writes in its slot the iterations of its main loop, the duration
+      of the last and of the longest one and the bytes waiting in its channel, read live by hb_monitor (make hbmon)
 */
 
 #pragma once
 
 #include <stdint.h>     
+#include <stdio.h>
+#include <string.h>
 #include <sys/types.h>  
 #include <time.h>     
+#include <errno.h>
+#include <signal.h>
+#include <stdatomic.h>
 #include <semaphore.h>  
 
 // POSIX shared memory name - used by all processes
 #define HB_SHM_NAME "/heartbeat"
 
-//slot for each process (each slot is private to the considered process)
+#define HB_LAYOUT_VERSION 4 //1: slots protected by one semaphore, 2: atomic slots on their own cache line, 3: registry, 4: loop statistics
+#define HB_CACHE_LINE 64
+#define HB_MAX_SLOTS 32 //one bit of ready_mask / boot_mask for each slot
+#define HB_NAME_LEN 20
+#define HB_SLOT_BLACKBOARD 0 //first claim, before the fork of the others
+#define HB_SIG_RESTART (SIGRTMIN) //watchdog -> blackboard: restart the worker in the value of the signal (queued, not merged)
+
+//processes of the game, claimed with these names (the registry accepts any other name, e.g. "DRONE.2")
+enum {
+  HB_PROC_BLACKBOARD,
+  HB_PROC_INPUT,
+  HB_PROC_DRONE,
+  HB_PROC_TARGETS,
+  HB_PROC_OBSTACLES,
+  HB_PROC_RENDERER, //only with the separate renderer process
+  HB_PROCS
+};
+
+//state of a slot
 enum {
-  HB_SLOT_BLACKBOARD = 0,
-  HB_SLOT_INPUT      = 1,
-  HB_SLOT_DRONE      = 2,
-  HB_SLOT_TARGETS    = 3,
-  HB_SLOT_OBSTACLES  = 4,
-  HB_SLOTS           = 5
+  HB_FREE = 0,
+  HB_CLAIMING, //name and parameters being written
+  HB_ACTIVE
 };
 
-//heartbeat struct
+//heartbeat struct (one cache line: the writes of a process do not invalidate the slots of the others)
 typedef struct {
-  uint64_t last_seen_ms; //last_seen to confirm the process is running
-  pid_t    pid; //pid to  identifier the process
+  _Alignas(HB_CACHE_LINE) _Atomic uint64_t last_seen_ms; //last_seen to confirm the process is running
+  _Atomic uint64_t iterations; //iterations of the main loop (hb_loop)
+  _Atomic pid_t pid; //pid to  identifier the process
+  _Atomic uint32_t state; //HB_FREE, HB_CLAIMING, HB_ACTIVE
+  uint32_t period_ms; //expected time between two heartbeats
+  uint32_t timeout_ms; //0: timeout of the watchdog
+  char name[HB_NAME_LEN];
+  _Atomic uint32_t loop_us; //duration of the last iteration
+  _Atomic uint32_t loop_max_us; //longest iteration since the claim
+  _Atomic uint32_t queue; //bytes waiting in the channel of the process at the end of the iteration
 } HbEntry;
 
 //heartbeat table stuct - one entry(slot) for each process
 typedef struct {
-  sem_t mutex; //semaphore used to protect the heartbeat table
-  HbEntry entries[HB_SLOTS];
+  uint32_t layout; //HB_LAYOUT_VERSION
+  uint32_t size; //sizeof(HeartbeatTable)
+  _Atomic uint32_t used; //slots below this index were claimed at least once (the watchdog scans only them)
+
+  HbEntry entries[HB_MAX_SLOTS];
+
+  //readiness barrier
+  _Alignas(HB_CACHE_LINE) sem_t ready; //posted once by every process when it is ready
+  _Atomic uint32_t ready_mask; //bit of the slots ready
+  _Atomic uint32_t boot_mask; //slots ready at the end of the barrier, written by the blackboard (0: still starting)
 } HeartbeatTable;
 
+_Static_assert(sizeof(HbEntry) == HB_CACHE_LINE, "a heartbeat slot must fill exactly one cache line");
+
 
 //monotonic clock - current time in milliseconds (all processes refresh their slot in the heartbeat table)
 static inline uint64_t now_ms(void) {
@@ -48,3 +99,168 @@ static inline uint64_t now_ms(void) {
     clock_gettime(CLOCK_MONOTONIC, &ts);
     return (uint64_t)ts.tv_sec * 1000ULL + (uint64_t)(ts.tv_nsec / 1000000ULL);
 }
+
+//heartbeat of a process: one store on its own slot
+static inline void hb_beat(HeartbeatTable *hb, int slot) {
+    atomic_store_explicit(&hb->entries[slot].last_seen_ms, now_ms(), memory_order_relaxed);
+}
+
+//statistics of one iteration of the main loop: plain stores on its own slot (only the process of the slot writes
+//them, no read-modify-write), a reader may see the counter of one iteration with the duration of the next one
+static inline void hb_loop(HeartbeatTable *hb, int slot, uint64_t loop_us, uint32_t queue) {
+    HbEntry *e = &hb->entries[slot];
+    uint32_t us = loop_us > UINT32_MAX ? UINT32_MAX : (uint32_t)loop_us;
+    atomic_store_explicit(&e->loop_us, us, memory_order_relaxed);
+    if (us > atomic_load_explicit(&e->loop_max_us, memory_order_relaxed)) {
+        atomic_store_explicit(&e->loop_max_us, us, memory_order_relaxed);
+    }
+    atomic_store_explicit(&e->queue, queue, memory_order_relaxed);
+    uint64_t n = atomic_load_explicit(&e->iterations, memory_order_relaxed);
+    atomic_store_explicit(&e->iterations, n + 1, memory_order_relaxed);
+}
+
+static inline void hb_set_pid(HeartbeatTable *hb, int slot, pid_t pid) {
+    atomic_store_explicit(&hb->entries[slot].pid, pid, memory_order_release);
+}
+
+static inline pid_t hb_pid(const HeartbeatTable *hb, int slot) {
+    return atomic_load_explicit(&hb->entries[slot].pid, memory_order_acquire);
+}
+
+static inline uint64_t hb_last_seen(const HeartbeatTable *hb, int slot) {
+    return atomic_load_explicit(&hb->entries[slot].last_seen_ms, memory_order_relaxed);
+}
+
+static inline int hb_active(const HeartbeatTable *hb, int slot) {
+    return atomic_load_explicit(&hb->entries[slot].state, memory_order_acquire) == HB_ACTIVE;
+}
+
+//slots to scan (claimed at least once)
+static inline int hb_used(const HeartbeatTable *hb) {
+    uint32_t n = atomic_load_explicit(&hb->used, memory_order_acquire);
+    return n < HB_MAX_SLOTS ? (int)n : HB_MAX_SLOTS;
+}
+
+//name of the processes of the game
+static inline const char *hb_proc_name(int proc) {
+    switch (proc) {
+        case HB_PROC_BLACKBOARD: return "BLACKBOARD";
+        case HB_PROC_INPUT: return "INPUT";
+        case HB_PROC_DRONE: return "DRONE";
+        case HB_PROC_TARGETS: return "TARGETS";
+        case HB_PROC_OBSTACLES: return "OBSTACLES";
+        case HB_PROC_RENDERER: return "RENDERER";
+        default: return "UNKNOWN";
+    }
+}
+
+//process of the game claimed with this name (HB_PROC_*), -1 for any other name
+static inline int hb_proc_of(const char *name) {
+    for (int p = 0; p < HB_PROCS; p++) {
+        if (strncmp(name, hb_proc_name(p), HB_NAME_LEN) == 0) return p;
+    }
+    return -1;
+}
+
+//blackboard: empty table with the layout of this build (before the fork)
+static inline void hb_init(HeartbeatTable *hb) {
+    for (int i = 0; i < HB_MAX_SLOTS; i++) {
+        atomic_init(&hb->entries[i].last_seen_ms, 0);
+        atomic_init(&hb->entries[i].pid, 0);
+        atomic_init(&hb->entries[i].state, HB_FREE);
+        atomic_init(&hb->entries[i].iterations, 0);
+        atomic_init(&hb->entries[i].loop_us, 0);
+        atomic_init(&hb->entries[i].loop_max_us, 0);
+        atomic_init(&hb->entries[i].queue, 0);
+    }
+    atomic_init(&hb->used, 0);
+    hb->layout = HB_LAYOUT_VERSION;
+    hb->size = (uint32_t)sizeof(HeartbeatTable);
+}
+
+//claim the first free slot (lock-free: one compare-and-swap on its state), return the slot or -1 if the table is full
+//the slot is active with a first heartbeat: the watchdog counts the timeout from the claim
+static inline int hb_claim(HeartbeatTable *hb, const char *name, pid_t pid, uint32_t period_ms, uint32_t timeout_ms) {
+    for (int i = 0; i < HB_MAX_SLOTS; i++) {
+        HbEntry *e = &hb->entries[i];
+        uint32_t expected = HB_FREE;
+        if (!atomic_compare_exchange_strong(&e->state, &expected, HB_CLAIMING)) continue;
+
+        snprintf(e->name, sizeof(e->name), "%s", name);
+        e->period_ms = period_ms;
+        e->timeout_ms = timeout_ms;
+        atomic_store_explicit(&e->iterations, 0, memory_order_relaxed); //statistics of the new process
+        atomic_store_explicit(&e->loop_us, 0, memory_order_relaxed);
+        atomic_store_explicit(&e->loop_max_us, 0, memory_order_relaxed);
+        atomic_store_explicit(&e->queue, 0, memory_order_relaxed);
+        atomic_store_explicit(&e->last_seen_ms, now_ms(), memory_order_relaxed);
+        atomic_store_explicit(&e->pid, pid, memory_order_relaxed);
+        atomic_store_explicit(&e->state, HB_ACTIVE, memory_order_release); //name and parameters visible
+
+        uint32_t used = atomic_load(&hb->used);
+        while (used < (uint32_t)i + 1 && !atomic_compare_exchange_weak(&hb->used, &used, (uint32_t)i + 1)) {}
+        return i;
+    }
+    return -1;
+}
+
+//watchdog: free the slot of a process that died or was killed (its restart claims a slot again)
+static inline void hb_release(HeartbeatTable *hb, int slot) {
+    atomic_fetch_and(&hb->ready_mask, ~(1u << slot));
+    atomic_store_explicit(&hb->entries[slot].pid, 0, memory_order_relaxed);
+    atomic_store_explicit(&hb->entries[slot].state, HB_FREE, memory_order_release);
+}
+
+//slot of an active process (first match), -1 if not registered
+static inline int hb_find(const HeartbeatTable *hb, const char *name) {
+    int used = hb_used(hb);
+    for (int i = 0; i < used; i++) {
+        if (hb_active(hb, i) && strncmp(hb->entries[i].name, name, HB_NAME_LEN) == 0) return i;
+    }
+    return -1;
+}
+
+//pids of the processes of the game (0: not registered), for the processes window
+static inline void hb_proc_pids(const HeartbeatTable *hb, pid_t pids[HB_PROCS]) {
+    for (int p = 0; p < HB_PROCS; p++) {
+        int slot = hb_find(hb, hb_proc_name(p));
+        pids[p] = slot >= 0 ? hb_pid(hb, slot) : 0;
+    }
+}
+
+//other processes: 1 if the table mapped has the layout of this build
+static inline int hb_layout_ok(const HeartbeatTable *hb, const char *name) {
+    if (hb->layout == HB_LAYOUT_VERSION && hb->size == sizeof(HeartbeatTable)) return 1;
+    fprintf(stderr, "%s: heartbeat table layout %u (%u bytes), expected %u (%zu bytes): rebuild all the binaries\n",
+            name, hb->layout, hb->size, HB_LAYOUT_VERSION, sizeof(HeartbeatTable));
+    return 0;
+}
+
+//process of the slot: table mapped, pid written and channel opened
+static inline void hb_ready(HeartbeatTable *hb, int slot) {
+    atomic_fetch_or(&hb->ready_mask, 1u << slot);
+    sem_post(&hb->ready);
+}
+
+//number of processes ready, the blackboard excluded
+static inline int hb_ready_count(const HeartbeatTable *hb) {
+    return __builtin_popcount(atomic_load(&hb->ready_mask) & ~(1u << HB_SLOT_BLACKBOARD));
+}
+
+//blackboard: wait until 'expected' processes are ready (return how many are still missing, 0 = all ready)
+static inline int hb_wait_ready(HeartbeatTable *hb, int expected, uint64_t timeout_ms) {
+    struct timespec deadline; //sem_timedwait uses the realtime clock
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += (time_t)(timeout_ms / 1000);
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    while (hb_ready_count(hb) < expected) {
+        if (sem_timedwait(&hb->ready, &deadline) < 0 && errno != EINTR) break; //timeout
+    }
+    int missing = expected - hb_ready_count(hb);
+    return missing > 0 ? missing : 0;
+}
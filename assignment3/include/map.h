@@ -6,18 +6,46 @@
 #ifndef MAP_H
 #define MAP_H
 
-#define MAX_OBSTACLES 20
-#define MAX_TARGETS 10
+//capacity of the lists of the GameState: it is copied as a whole in the state shm and in the drone shm (no pointers),
+//so the arrays stay fixed; the workers and their messages have no cap, the blackboard keeps the first MAX_* entries
+#define MAX_OBSTACLES 1024
+#define MAX_TARGETS 256
 
 #include <ncurses.h>
 
 //------------------------------------------------------------------------STRUCTS
 
+typedef enum { //use to define the game mode: soloplayer, server or client
+    MODE_SOLO = 1,
+    MODE_SERVER = 2,
+    MODE_CLIENT = 3
+} GameMode;
+
+#define ZOOM_LEVELS 6 //0 = whole world, level z>0 = 2^(z-1) world cells for each screen cell
+
+// Camera struct (viewport on the world)
+typedef struct {
+    double x0, y0; //world coordinates of the top-left visible cell
+    double scale_x, scale_y; //world cells for each screen cell
+
+    //spatial index of the obstacles, rebuilt only when the obstacles change
+    int bucket; //bucket side in world cells
+    int grid_w, grid_h; //number of buckets
+    int *start; //first obstacle of every bucket (grid_w*grid_h + 1 offsets)
+    int *index; //obstacle indices ordered by bucket
+    int *sat; //summed area table of the bucket counts ((grid_w+1)*(grid_h+1))
+    int index_cap;
+    unsigned rev; //obstacles revision of the index
+    int world_w, world_h; //world size of the index
+    int valid;
+} Camera;
+
 // Window struct
 typedef struct {
     WINDOW *win;
     int width, height; //dimension
     int startx, starty; //start position of the drone
+    Camera cam; //visible part of the world
 } Screen;
 
 
@@ -79,6 +107,7 @@ typedef struct {
     //obstacles
     int num_obstacles;
     Obstacle obstacles[MAX_OBSTACLES];
+    unsigned obstacles_rev; //incremented every time the obstacles change (camera index)
 
     //target
     int num_targets;
@@ -97,6 +126,10 @@ typedef struct {
     int was_on_obstacles;
     int obstacles_hit_tot;
     int fence_collision_tot;
+
+    //view
+    int zoom; //camera zoom level (0 = whole world)
+    int overlay; //performance overlay visible (key 'o')
 } GameState;
 
 
@@ -132,6 +165,26 @@ typedef struct {
 
     //network
     int rotation; 
+
+    //renderer process
+    int render_fps;
+
+    //inspection panels
+    int panel_refresh_ms;
+
+    //worker messages (TRANSPORT=ring|pipe)
+    int transport_ring;
+
+    //drone dynamics integrated by the drone process (PHYSICS_OWNER=drone|blackboard)
+    int physics_drone;
+
+    //scheduling profile of the tick path (rt_profile.h)
+    int cpu_blackboard, cpu_drone, cpu_watchdog; //-1: not pinned
+    int rt_priority; //SCHED_FIFO priority, 0: normal scheduler
+    int mlock; //mlockall in the blackboard, drone and watchdog
+
+    //supervisor: restarts of every worker after a crash or a hang (0: the first failure stops the game)
+    int restart_workers;
 } Config;
 
 //------------------------------------------------------------------------FUNCTIONS
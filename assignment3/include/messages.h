@@ -0,0 +1,144 @@
+/* messages.h
+    frames sent by the workers to the blackboard on their channel (transport.h)
+
+    - header: type, payload length, sequence number of the channel, send time (monotonic us)
+    - payload sized to its content:
+        - input and drone: two ints
+        - targets and obstacles: number of entries followed by only the valid entries, no compile-time cap in the frame
+    - the blackboard reassembles the frames split between two reads (ChanBatch) and counts the gaps in the sequence
+    - the payload points into the batch buffer: the entries are copied with memcpy (no alignment assumption)
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <poll.h>
+#include <errno.h>
+#include <signal.h>
+
+#include "transport.h"
+#include "perf.h"
+
+#define MSG_MAX_PAYLOAD (1u << 20) //a longer length means a corrupted channel
+
+typedef struct {
+  char type;
+  uint8_t reserved[3];
+  uint32_t len; //payload bytes after the header
+  uint32_t seq; //sequence number on the channel, from 0
+  uint32_t reserved2;
+  uint64_t sent_us; //now_us() of the worker
+} MsgHeader;
+
+//input: direction or camera step ('I', 'B', 'Z', ...)
+typedef struct {
+  int dx, dy;
+} msgInput;
+
+//drone: position after the step ('D')
+typedef struct {
+  int x, y;
+} msgDrone;
+
+//targets and obstacles ('T', 'O', 'R'): num entries (Target or Obstacle) follow
+typedef struct {
+  int num;
+} msgList;
+
+
+//worker: send one frame, the payload made of two parts (b can be NULL)
+static inline int msg_send_parts(Channel *c, char type, const void *a, size_t alen, const void *b, size_t blen) {
+    size_t total = sizeof(MsgHeader) + alen + blen;
+    unsigned char stack[256];
+    unsigned char *buf = (total <= sizeof(stack)) ? stack : malloc(total); //one send for the whole frame
+    if (!buf) return -1;
+
+    MsgHeader h;
+    memset(&h, 0, sizeof(h));
+    h.type = type;
+    h.len = (uint32_t)(alen + blen);
+    h.seq = c->seq++;
+    h.sent_us = now_us();
+
+    memcpy(buf, &h, sizeof(h));
+    if (alen) memcpy(buf + sizeof(h), a, alen);
+    if (blen) memcpy(buf + sizeof(h) + alen, b, blen);
+
+    ssize_t n = chan_send(c, buf, total);
+    if (buf != stack) free(buf);
+    return (n == (ssize_t)total) ? 0 : -1;
+}
+
+static inline int msg_send(Channel *c, char type, const void *payload, size_t len) {
+    return msg_send_parts(c, type, payload, len, NULL, 0);
+}
+
+//worker: num entries of entry_size bytes (targets or obstacles)
+static inline int msg_send_list(Channel *c, char type, const void *entries, int num, size_t entry_size) {
+    msgList l = { num };
+    return msg_send_parts(c, type, &l, sizeof(l), entries, (size_t)num * entry_size);
+}
+
+//blackboard: next whole frame of the batch (the payload is valid until the next drain)
+//return 1 with a frame, 0 when the frame is not complete yet, -1 when the channel is corrupted
+static inline int msg_next(ChanBatch *b, MsgHeader *h, const unsigned char **payload) {
+    size_t avail = b->len - b->pos;
+    if (avail < sizeof(MsgHeader)) return 0;
+
+    memcpy(h, b->data + b->pos, sizeof(*h));
+    if (h->len > MSG_MAX_PAYLOAD) return -1;
+    size_t need = sizeof(*h) + h->len;
+    if (avail < need) { //longer than the buffer: room for the rest at the next drain
+        return (chan_batch_reserve(b, need) < 0) ? -1 : 0;
+    }
+
+    *payload = b->data + b->pos + sizeof(*h);
+    b->pos += need;
+
+    if (h->seq != b->next_seq) b->lost += (uint32_t)(h->seq - b->next_seq); //gap (a restarted worker starts again from 0)
+    b->next_seq = h->seq + 1;
+    return 1;
+}
+
+//copy a fixed payload (return 0 when the frame is shorter)
+static inline int msg_copy(const MsgHeader *h, const unsigned char *payload, void *out, size_t len) {
+    if (h->len < len) return 0;
+    memcpy(out, payload, len);
+    return 1;
+}
+
+//entries of a list payload: number of whole entries in the frame, the first 'max' copied in out
+static inline int msg_list(const MsgHeader *h, const unsigned char *payload, void *out, size_t entry_size, int max) {
+    msgList l;
+    if (!msg_copy(h, payload, &l, sizeof(l)) || l.num < 0) return 0;
+
+    size_t fit = (h->len - sizeof(l)) / entry_size;
+    int num = ((size_t)l.num < fit) ? l.num : (int)fit;
+    int copy = (num < max) ? num : max;
+    memcpy(out, payload + sizeof(l), (size_t)copy * entry_size);
+    return num;
+}
+
+//blackboard: wait for the next frame (used before the event loop, the channel is non-blocking)
+//hup_fd: pipe read end of the worker, closed when it dies (with the ring the eventfd never tells it), -1: not watched
+//return 1 with a frame, 0 after timeout_ms, -1 when the worker died, *stop was set or on error
+static inline int msg_recv_wait(Channel *c, ChanBatch *b, int hup_fd, int timeout_ms, const volatile sig_atomic_t *stop,
+                                MsgHeader *h, const unsigned char **payload) {
+    uint64_t deadline = now_us() + (uint64_t)timeout_ms * 1000ULL;
+    for (;;) {
+        int r = msg_next(b, h, payload);
+        if (r != 0) return r;
+        if (stop && *stop) return -1;
+
+        uint64_t now = now_us();
+        if (now >= deadline) return 0;
+        struct pollfd pfd[2] = { { .fd = c->fd, .events = POLLIN }, { .fd = hup_fd, .events = 0 } };
+        int n = poll(pfd, (hup_fd >= 0 && hup_fd != c->fd) ? 2 : 1, (int)((deadline - now + 999) / 1000));
+        if (n < 0 && errno != EINTR) return -1;
+        if (n <= 0) continue; //signal or timeout: checked above
+        int closed = chan_drain(c, b) < 0 || (pfd[1].revents & (POLLHUP | POLLERR));
+        if (closed) return msg_next(b, h, payload) > 0 ? 1 : -1; //the worker died: only a frame it sent before
+    }
+}
@@ -0,0 +1,74 @@
+/* this file contains the inspection panels of the ncurses interface
+    - info, processes, collisions and help windows
+    - every line is formatted again only when its value changes
+    - the windows are refreshed every PANEL_REFRESH_ms (lower rate than the map)
+    - performance overlay (key 'o'): covers the processes and help windows while it is active
+    - game mode label under the map
+    - final statistics window
+*/
+
+#ifndef PANELS_H
+#define PANELS_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "map.h"
+#include "heartbeat.h"
+#include "perf.h"
+
+//lines of the panels
+enum {
+    FIELD_CMD,
+    FIELD_OBST,
+    FIELD_FENCE,
+    FIELD_VEL,
+    FIELD_POS,
+    FIELD_TARGETS,
+    FIELD_PID_INPUT,
+    FIELD_PID_DRONE,
+    FIELD_PID_TARGETS,
+    FIELD_PID_OBSTACLES,
+    FIELD_OBSTACLES_HIT,
+    FIELD_FENCE_HIT,
+    FIELD_SCORE,
+    PANEL_FIELDS
+};
+
+//last value printed in a line
+typedef struct {
+    double a, b;
+    int valid; //0 -> the line is printed at the next refresh
+} PanelField;
+
+// Panels struct
+typedef struct {
+    WINDOW *info_win; //forces, velocity, position
+    WINDOW *processes_win; //pid of the processes
+    WINDOW *collision_win; //collisions and score
+    WINDOW *help_win; //help
+    WINDOW *perf_win; //performance overlay (NULL when hidden)
+    uint64_t perf_window; //summary printed in the overlay
+
+    PanelField fields[PANEL_FIELDS];
+    int refresh_ms; //minimum time between two refreshes (0 = every call)
+    uint64_t last_refresh_ms;
+
+    //statistics (logged at shutdown)
+    unsigned long calls; //draw_panels calls
+    unsigned long skipped; //calls inside the refresh interval
+    unsigned long formatted; //lines formatted again
+    unsigned long unchanged; //lines skipped because the value did not change
+    unsigned long refreshes; //windows sent to the terminal
+} Panels;
+
+void init_panels(Panels *p, int refresh_ms);
+void draw_panels(Panels *p, const GameState *g, const pid_t pids[HB_PROCS]);
+void invalidate_panels(Panels *p);
+void set_overlay(Panels *p, int on);
+void draw_overlay(Panels *p, const PerfSummary *perf);
+void report_panels(const Panels *p, const char *process_name);
+void print_mode(Screen *s, GameMode mode);
+void show_final_win(const GameState *g);
+
+#endif
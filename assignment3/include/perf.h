@@ -0,0 +1,176 @@
+/* this file contains the latency histograms used to measure the processes
+    - fixed histogram with power of two buckets (microseconds): no allocation, constant time record
+    - percentiles are the upper bound of the bucket (clamped to the max seen)
+    - histograms are header only, like heartbeat.h and logger.h
+    - PerfStats (perf.c): one second windows of the blackboard loop, summarized for the overlay
+    - PerfTrace: latency of the messages of each channel from the send time of the worker (messages.h) to the screen
+*/
+
+#ifndef PERF_H
+#define PERF_H
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "logger.h"
+
+#define PERF_BUCKETS 32 //bucket i: values in [2^(i-1), 2^i) us, bucket 0: 0 us
+
+typedef struct {
+    uint64_t buckets[PERF_BUCKETS];
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+} PerfHist;
+
+//monotonic clock - current time in microseconds
+static inline uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)(ts.tv_nsec / 1000ULL);
+}
+
+static inline void perf_reset(PerfHist *h) {
+    memset(h, 0, sizeof(*h));
+}
+
+//add a value (us) to the histogram
+static inline void perf_record(PerfHist *h, uint64_t us) {
+    int b = 0;
+    while (b < PERF_BUCKETS - 1 && (us >> b) != 0) b++; //number of bits of the value
+    h->buckets[b]++;
+    h->count++;
+    h->sum += us;
+    if (us > h->max) h->max = us;
+}
+
+//value under which there are p% of the samples (p in 0..100)
+static inline uint64_t perf_percentile(const PerfHist *h, double p) {
+    if (h->count == 0) return 0;
+
+    uint64_t rank = (uint64_t)(p / 100.0 * (double)h->count + 0.5);
+    if (rank == 0) rank = 1;
+
+    uint64_t seen = 0;
+    for (int b = 0; b < PERF_BUCKETS; b++) {
+        seen += h->buckets[b];
+        if (seen >= rank) {
+            uint64_t upper = (b == 0) ? 0 : (1ULL << b) - 1;
+            return upper < h->max ? upper : h->max;
+        }
+    }
+    return h->max;
+}
+
+//write count, percentiles and max in the log
+static inline void perf_log(const PerfHist *h, const char *process_name, const char *what) {
+    if (h->count == 0) {
+        log_message(process_name, "[PERF] %s: no samples", what);
+        return;
+    }
+    log_message(process_name, "[PERF] %s: n=%llu mean=%lluus p50<=%lluus p99<=%lluus max=%lluus", what,
+                (unsigned long long)h->count, (unsigned long long)(h->sum / h->count),
+                (unsigned long long)perf_percentile(h, 50), (unsigned long long)perf_percentile(h, 99),
+                (unsigned long long)h->max);
+}
+
+//-----------------------------------------------------------------------LIVE STATISTICS (perf.c)
+
+//pipes counted by the overlay
+enum {
+    PERF_PIPE_INPUT,
+    PERF_PIPE_DRONE,
+    PERF_PIPE_TARGETS,
+    PERF_PIPE_OBSTACLES,
+    PERF_PIPES
+};
+
+//values of the last complete window (shown by the overlay, copied in the state snapshot)
+typedef struct {
+    uint64_t window; //number of the window (0 = no data yet)
+    double tick_hz; //physics ticks per second
+    uint64_t loop_p50_us, loop_p99_us; //select wake-up -> end of the iteration
+    uint64_t render_p50_us, render_p99_us; //map + panels of one frame
+    uint64_t frames; //frames drawn in the window
+    uint64_t pipe_msgs[PERF_PIPES]; //messages per second
+    uint64_t term_bytes_s; //bytes flushed to the terminal per second
+    uint64_t term_bytes_total;
+    uint64_t wakeups_s; //returns of the event loop per second
+    uint64_t dispatch_p50_us, dispatch_p99_us; //timer expiration -> handler
+    uint64_t batch_max[PERF_PIPES]; //most messages handled in one wake-up
+} PerfSummary;
+
+//stages of the messages of one channel, from the send time stamped by the worker (us)
+typedef struct {
+    PerfHist received; //send -> read by the blackboard
+    PerfHist applied; //send -> effect in the game state (add_direction, add_drone_dynamics, new targets/obstacles)
+    PerfHist shown; //send -> end of the first frame with the effect (state published when nothing is drawn)
+    uint64_t pending_us; //oldest send time applied and not shown yet (0: none)
+} PerfTrace;
+
+typedef struct {
+    //current window
+    uint64_t window_start_ms;
+    PerfHist loop, render;
+    uint64_t ticks;
+    uint64_t pipe_msgs[PERF_PIPES];
+    uint64_t term_bytes;
+    uint64_t wakeups;
+    PerfHist dispatch;
+    uint64_t batch_max[PERF_PIPES];
+
+    //whole run (logged at shutdown)
+    PerfHist loop_total, render_total, dispatch_total;
+    PerfHist batch_total[PERF_PIPES]; //messages handled for each wake-up of a pipe
+    uint64_t term_bytes_total;
+    uint64_t wakeups_total;
+    PerfTrace trace[PERF_PIPES];
+
+    //render in progress
+    uint64_t render_start_us;
+    uint64_t render_start_wchar;
+
+    uint64_t start_ms; //start of the run
+    int io_fd; //'/proc/self/io': bytes written by the process (-1 if not available)
+    PerfSummary summary;
+} PerfStats;
+
+void perf_stats_init(PerfStats *p);
+void perf_stats_close(PerfStats *p);
+void perf_loop_done(PerfStats *p, uint64_t wake_us);
+void perf_render_begin(PerfStats *p);
+void perf_render_end(PerfStats *p);
+int perf_stats_roll(PerfStats *p, uint64_t now); //1 when a new summary is ready
+void perf_trace_shown(PerfStats *p, uint64_t now); //the effects applied until now are on the screen
+void perf_stats_log(const PerfStats *p, const char *process_name);
+
+static inline void perf_count_tick(PerfStats *p) { p->ticks++; }
+static inline void perf_count_msg(PerfStats *p, int pipe) { p->pipe_msgs[pipe]++; }
+static inline void perf_count_wakeup(PerfStats *p) { p->wakeups++; p->wakeups_total++; }
+
+static inline void perf_trace_received(PerfStats *p, int pipe, uint64_t sent_us, uint64_t now) {
+    perf_record(&p->trace[pipe].received, now > sent_us ? now - sent_us : 0);
+}
+
+//the effect of a message sent at sent_us is in the game state: waits for the next frame
+static inline void perf_trace_applied(PerfStats *p, int pipe, uint64_t sent_us, uint64_t now) {
+    PerfTrace *t = &p->trace[pipe];
+    perf_record(&t->applied, now > sent_us ? now - sent_us : 0);
+    if (t->pending_us == 0 || sent_us < t->pending_us) t->pending_us = sent_us;
+}
+
+//messages handled in one wake-up of a pipe
+static inline void perf_count_batch(PerfStats *p, int pipe, uint64_t n) {
+    if (n == 0) return;
+    perf_record(&p->batch_total[pipe], n);
+    if (n > p->batch_max[pipe]) p->batch_max[pipe] = n;
+}
+
+//delay of a timer handler
+static inline void perf_dispatch(PerfStats *p, uint64_t late_us) {
+    perf_record(&p->dispatch, late_us);
+    perf_record(&p->dispatch_total, late_us);
+}
+
+#endif
@@ -1,5 +1,6 @@
 /* this file contains the process drone which moves the drone
     - sends tick message to the blackboard to trigger drone updates
+    - PHYSICS_OWNER=drone: integrates the drone dynamics before the tick (drone_shm.h)
     - updates the heartbeat slot to signal activity to the watchdog
 */
 
@@ -8,12 +9,17 @@
 
 
 #include "heartbeat.h"
+#include "transport.h"
+#include "drone_shm.h"
 
-void move_drone(int fd, HeartbeatTable *hb, int slot);
+#define DRONE_PERIOD_ms 20 //one tick message (and one integration step) every period
+
+void move_drone(Channel *ch, HeartbeatTable *hb, int slot, DroneShm *shm);
 /* arguments
-    - fd: write-end of the pipe toward the blackboard
+    - ch: channel toward the blackboard (pipe write-end or shared memory ring)
     - hb: pointer to shared heartbeat table
     - slot:index in the heartbeat table assigned to this process
+    - shm: drone shm when this process owns the integration, NULL when the blackboard does it
 */
 
 #endif
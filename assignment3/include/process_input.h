@@ -8,13 +8,18 @@
 
 #include <ncurses.h>
 #include "heartbeat.h"
+#include "perf.h"
+#include "transport.h"
 
-void set_input(int fd, WINDOW *win, HeartbeatTable *hb, int slot);
+#define INPUT_HB_TIMEOUT_ms 200 //max time blocked on stdin without updating the heartbeat
+
+void set_input(Channel *chan, WINDOW *win, HeartbeatTable *hb, int slot, PerfHist *latency);
 /* arguments
-    - fd: write-end of the pipe toward the blackboard
+    - chan: channel toward the blackboard (pipe write-end or shared memory ring)
     - win: ncurses window used to display input keys
     - hb: pointer to shared heartbeat table
     - slot: index in the heartbeat table assigned to this process
+    - latency: histogram of the time from keypress available to pipe write
 */
 
 #endif
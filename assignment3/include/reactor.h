@@ -0,0 +1,46 @@
+/* this file contains the event loop helpers of the blackboard (epoll)
+    - every fd is registered once with a tag, epoll returns only the ready ones
+    - periodic timers with timerfd (heartbeat, render): the delay of the dispatch is measured
+    - signals read from a signalfd in the loop (no flags set by handlers, no lost wake-up)
+*/
+
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include <stdint.h>
+#include <signal.h>
+
+//periodic timer (timerfd)
+typedef struct {
+    int fd;
+    uint64_t period_us;
+    uint64_t start_us; //first expiration = start + period
+    uint64_t expirations; //expirations read until now
+} ReactorTimer;
+
+int reactor_create(void);
+int reactor_add(int epfd, int fd, uint32_t tag);
+/* arguments
+    - epfd: epoll instance
+    - fd: descriptor to watch for input (level triggered)
+    - tag: value returned in the event (data.u32)
+*/
+int reactor_del(int epfd, int fd); //stop watching (e.g. a pipe closed by a dead worker)
+
+int reactor_timer(ReactorTimer *t, uint64_t period_ms);
+uint64_t reactor_timer_fire(ReactorTimer *t, uint64_t now, uint64_t *late_us);
+/* arguments
+    - t: timer that epoll reported as ready
+    - now: current time (now_us)
+    - late_us: delay between the last expiration and the dispatch
+    return the number of expirations since the previous read (0 if none)
+*/
+
+int reactor_signals(const int *sigs, int n);
+int reactor_signal_read(int sfd);
+int reactor_signal_info(int sfd, int *value);
+/* reactor_signals blocks the signals (call it after the fork of the children) and returns the signalfd,
+   reactor_signal_read returns the signal number read from it (0 if none),
+   reactor_signal_info also returns the value of a signal sent with sigqueue (0 for kill) */
+
+#endif
@@ -0,0 +1,31 @@
+/* rt_profile.h
+    scheduling profile of the tick path: blackboard, process_drone and watchdog (rt_profile.c)
+
+    - CPU_BLACKBOARD, CPU_DRONE, CPU_WATCHDOG in the config: core of each process (-1: not pinned)
+    - RT_PRIORITY: SCHED_FIFO priority 1..99 of the three processes (0: normal scheduler)
+    - MLOCKALL=1: memory of the three processes locked (no page faults in the tick path)
+    - affinity and policy are set in the child between fork and exec (they are kept by exec),
+      the memory locks are not kept: the child gets RT_MLOCKALL=1 in its environment and locks itself at the start
+    - a missing permission (CAP_SYS_NICE, RLIMIT_RTPRIO, RLIMIT_MEMLOCK) is logged and the process keeps running
+*/
+
+#ifndef RT_PROFILE_H
+#define RT_PROFILE_H
+
+#define RT_MLOCK_ENV "RT_MLOCKALL"
+
+int rt_apply(const char *name, int cpu, int priority);
+/* arguments
+    - name: process name in the log
+    - cpu: core of the calling process (-1: not changed)
+    - priority: SCHED_FIFO priority (0: not changed)
+    return 0 when everything requested is applied, -1 otherwise
+*/
+
+int rt_mlock(const char *name); //lock the current and future memory of the process
+
+void rt_child(const char *name, int cpu, int priority, int mlock); //forked child before exec: rt_apply and the environment for the lock
+
+int rt_mlock_from_env(const char *name); //exec'd process: lock the memory if the blackboard asked it
+
+#endif
@@ -0,0 +1,70 @@
+/* runtime.h
+    threaded runtime (make threaded -> build/bin/blackboard_threaded, -DTHREADED_RUNTIME)
+
+    - input, drone, targets, obstacles and watchdog run as threads of the blackboard instead of processes
+    - the threads call the same main of the processes (renamed with WORKER_MAIN), with the same arguments of the exec
+    - the channels are the same shared memory rings (in-process memory), the fds are duplicated for every thread
+    - the loops of the workers check runtime_running(): the blackboard stops them and joins them at the shutdown
+    - without THREADED_RUNTIME everything is a no-op and the workers are normal processes
+*/
+
+#ifndef RUNTIME_H
+#define RUNTIME_H
+
+#include <time.h>
+
+#ifdef THREADED_RUNTIME
+
+#include <stdatomic.h>
+
+#define WORKER_MAIN(name) name##_main //the main of the process becomes a function of the blackboard
+
+extern atomic_int g_runtime_stop;
+
+int input_main(int argc, char *argv[]);
+int drone_main(int argc, char *argv[]);
+int targets_main(int argc, char *argv[]);
+int obstacles_main(int argc, char *argv[]);
+int watchdog_main(int argc, char **argv);
+
+int runtime_spawn(const char *name, int (*entry)(int, char **), int argc, char *argv[]);
+/* arguments
+    - name: name of the worker in the log
+    - entry: main of the worker
+    - argc, argv: arguments of the exec (copied, the caller can reuse them)
+    return 0 when the thread is started
+*/
+
+void runtime_stop(void); //ask all the workers to return (instead of SIGTERM)
+void runtime_join(void); //wait all the workers and log the return code
+
+static inline int runtime_running(void) {
+    return !atomic_load_explicit(&g_runtime_stop, memory_order_relaxed);
+}
+
+#else
+
+#define WORKER_MAIN(name) main
+
+static inline int runtime_running(void) {
+    return 1; //a process stops with SIGTERM
+}
+
+#endif
+
+//sleep that returns early when the runtime stops (threads), a normal nanosleep otherwise
+static inline void runtime_sleep(const struct timespec *ts) {
+#ifdef THREADED_RUNTIME
+    struct timespec step = {0, 10 * 1000 * 1000}; //check the stop every 10 ms
+    long long left = (long long)ts->tv_sec * 1000000000LL + ts->tv_nsec;
+    while (left > 0 && runtime_running()) {
+        if (left < step.tv_nsec) step.tv_nsec = (long)left;
+        nanosleep(&step, NULL);
+        left -= step.tv_nsec;
+    }
+#else
+    nanosleep(ts, NULL);
+#endif
+}
+
+#endif
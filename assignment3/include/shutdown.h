@@ -0,0 +1,29 @@
+/* shutdown.h
+    parallel shutdown of the child processes of the blackboard (shutdown.c)
+
+    - the signal is sent to all the children together, then one epoll set waits all their pidfds:
+      a child is reaped as soon as it exits, not in the order of the list
+    - one global deadline for all the children: who is still alive at the deadline gets SIGKILL
+    - without pidfd (old kernel) the children are checked with waitpid(WNOHANG) every 10 ms, same deadline
+    - the log reports how each child ended and the time of the whole shutdown
+*/
+
+#ifndef SHUTDOWN_H
+#define SHUTDOWN_H
+
+#include <sys/types.h>
+
+typedef struct {
+    pid_t pid; //0 or -1: not started (skipped)
+    const char *name;
+} ChildProc;
+
+int shutdown_children(const ChildProc *children, int num, int sig, int deadline_ms);
+/* arguments
+    - children: processes to stop, the signal is sent in this order
+    - sig: first signal (SIGTERM), 0 if it was already sent
+    - deadline_ms: time given to all the children together before SIGKILL
+    return the number of children killed at the deadline
+*/
+
+#endif
@@ -0,0 +1,82 @@
+/* state_shm.h
+    shared memory object (shm) with the snapshot of the GameState published by the blackboard
+    used by the renderer process and by any other reader (state_monitor) without pipes
+
+    - always created by the blackboard, published at the end of a loop iteration that changed the state
+      (physics tick, commands, respawns), never by the readers
+    - POSIX shm -> the blackboard maps it read/write, the readers map it read-only
+    - seqlock: the blackboard makes the sequence odd while it copies the snapshot, even when it is done
+    - the readers copy the snapshot and retry if the sequence changed (never wait the blackboard)
+    - the blackboard writes in place (state_write_begin / state_write_end): no second copy of the GameState
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <sys/types.h>
+
+#include "map.h"
+#include "heartbeat.h"
+#include "perf.h"
+
+// POSIX shared memory name - blackboard (writer) and readers
+#define STATE_SHM_NAME "/gamestate"
+
+//snapshot published by the blackboard
+typedef struct {
+  uint64_t tick; //number of published snapshots
+  uint64_t physics_ticks; //drone steps integrated until now
+  uint64_t publish_us; //now_us() of the publication (age of the snapshot for the readers)
+  int running; //0 when the blackboard is shutting down
+  int game_over; //all the targets collected -> final statistics
+  GameMode mode;
+  pid_t pids[HB_PROCS]; //used for the processes window (HB_PROC_*)
+  PerfSummary perf; //statistics of the blackboard for the overlay
+  GameState gs;
+} StateSnapshot;
+
+//shared memory struct
+typedef struct {
+  _Atomic uint32_t seq; //seqlock sequence (odd = write in progress)
+  StateSnapshot snap;
+} StateShm;
+
+
+//start a write in place (only one writer: the blackboard), the fields not written keep the old value
+static inline StateSnapshot *state_write_begin(StateShm *shm) {
+    uint32_t seq = atomic_load_explicit(&shm->seq, memory_order_relaxed);
+    atomic_store_explicit(&shm->seq, seq + 1, memory_order_relaxed); //odd -> readers retry
+    atomic_thread_fence(memory_order_release);
+    return &shm->snap;
+}
+
+static inline void state_write_end(StateShm *shm) {
+    uint32_t seq = atomic_load_explicit(&shm->seq, memory_order_relaxed);
+    atomic_store_explicit(&shm->seq, seq + 1, memory_order_release); //even -> snapshot consistent
+}
+
+//publish a whole snapshot
+static inline void state_publish(StateShm *shm, const StateSnapshot *snap) {
+    memcpy(state_write_begin(shm), snap, sizeof(*snap));
+    state_write_end(shm);
+}
+
+//copy a consistent snapshot (retry while the blackboard is writing), return the sequence read
+static inline uint32_t state_read(const StateShm *shm, StateSnapshot *out) {
+    for (int attempt = 0; ; attempt++) {
+        uint32_t s1 = atomic_load_explicit(&shm->seq, memory_order_acquire);
+        if (s1 & 1) { //write in progress
+            if (attempt > 100) sched_yield();
+            continue;
+        }
+
+        memcpy(out, &shm->snap, sizeof(*out));
+        atomic_thread_fence(memory_order_acquire);
+
+        uint32_t s2 = atomic_load_explicit(&shm->seq, memory_order_relaxed);
+        if (s1 == s2) return s1; //no write during the copy
+    }
+}
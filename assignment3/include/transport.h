@@ -0,0 +1,322 @@
+/* transport.h
+    channel used by a worker process to send its messages (frames of messages.h) to the blackboard
+
+    - pipe (fallback): one write, one read and one wake-up for every message
+    - ring: single producer / single consumer byte ring in a POSIX shm, one for each worker
+        - the producer copies the message and moves head, the consumer copies it and moves tail
+        - no lock: head is written only by the producer, tail only by the consumer
+        - eventfd notification only when the ring goes from empty to non-empty
+          (producer: store head, fence, load tail / consumer: store tail, fence, load head)
+    - selected with TRANSPORT=ring|pipe in the config, the workers get '--ring <shm> <eventfd>'
+    - a message longer than the free space of the ring is written in pieces, the blackboard reassembles it
+    - ChanBatch: the blackboard reads everything available at each wake-up and handles the whole messages,
+      a message split between two reads stays in the buffer until the next one (the buffer grows for long messages)
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+
+#include "runtime.h"
+
+#define RING_SIZE 8192 //bytes, power of two (more than 40 obstacle messages)
+#define CHAN_BATCH_SIZE 4096 //initial bytes read at once by the blackboard
+#define CHAN_FULL_WAIT_ms 1000 //longest wait on a full ring before the message is dropped (watchdog timeout: 2000 ms)
+
+typedef enum {
+  TRANSPORT_PIPE,
+  TRANSPORT_RING
+} TransportKind;
+
+//shared memory ring (head and tail on different cache lines)
+typedef struct {
+  _Alignas(64) _Atomic uint64_t head; //bytes written (producer)
+  _Alignas(64) _Atomic uint64_t tail; //bytes read (consumer)
+  _Alignas(64) unsigned char data[RING_SIZE];
+} ShmRing;
+
+//one end of a channel
+typedef struct {
+  TransportKind kind;
+  int fd; //pipe end, or eventfd for the ring
+  ShmRing *ring;
+  char name[32]; //shm name of the ring
+  uint32_t seq; //sequence number of the next message sent (messages.h)
+} Channel;
+
+//messages read from a channel and not handled yet
+typedef struct {
+  unsigned char *data; //allocated at the first drain
+  size_t cap;
+  size_t len; //bytes in data
+  size_t pos; //first byte not handled
+  uint32_t next_seq; //sequence number expected from the worker (messages.h)
+  uint64_t lost; //messages missing in the sequence
+} ChanBatch;
+
+
+//pipe channel (the fd is the read end in the blackboard, the write end in the worker)
+static inline void chan_pipe(Channel *c, int fd) {
+    memset(c, 0, sizeof(*c));
+    c->kind = TRANSPORT_PIPE;
+    c->fd = fd;
+}
+
+//blackboard: create the ring and its eventfd before the fork (return -1 on error: use the pipe)
+static inline int chan_create_ring(Channel *c, const char *name) {
+    memset(c, 0, sizeof(*c));
+    snprintf(c->name, sizeof(c->name), "%s", name);
+
+    int shm_fd = shm_open(name, O_CREAT | O_RDWR, 0666);
+    if (shm_fd < 0) return -1;
+    if (ftruncate(shm_fd, sizeof(ShmRing)) < 0) {
+        close(shm_fd);
+        shm_unlink(name);
+        return -1;
+    }
+    c->ring = mmap(NULL, sizeof(ShmRing), PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+    close(shm_fd);
+    if (c->ring == MAP_FAILED) {
+        c->ring = NULL;
+        shm_unlink(name);
+        return -1;
+    }
+    memset(c->ring, 0, sizeof(ShmRing));
+
+    c->fd = eventfd(0, EFD_NONBLOCK); //inherited by the worker (no CLOEXEC)
+    if (c->fd < 0) {
+        munmap(c->ring, sizeof(ShmRing));
+        c->ring = NULL;
+        shm_unlink(name);
+        return -1;
+    }
+    c->kind = TRANSPORT_RING;
+    return 0;
+}
+
+//worker: pipe write end, or the ring when the arguments contain '--ring <shm> <eventfd>'
+static inline void chan_from_args(Channel *c, int pipe_fd, int argc, char *argv[]) {
+    chan_pipe(c, pipe_fd);
+
+    for (int i = 1; i + 2 < argc; i++) {
+        if (strcmp(argv[i], "--ring") != 0) continue;
+
+        int shm_fd = shm_open(argv[i + 1], O_RDWR, 0666);
+        if (shm_fd < 0) return; //fallback: pipe
+        ShmRing *ring = mmap(NULL, sizeof(ShmRing), PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+        close(shm_fd);
+        if (ring == MAP_FAILED) return;
+
+        c->kind = TRANSPORT_RING;
+        c->ring = ring;
+        c->fd = atoi(argv[i + 2]);
+        snprintf(c->name, sizeof(c->name), "%s", argv[i + 1]);
+        return;
+    }
+}
+
+//send a message (the ring waits while it is full, like a blocking write on a full pipe, at most CHAN_FULL_WAIT_ms
+//and only while the runtime runs: then -1 and the caller drops the message)
+//a message that fits in the ring is written at once, a longer one in pieces as the blackboard frees space
+static inline ssize_t chan_send(Channel *c, const void *msg, size_t len) {
+    const unsigned char *p = msg;
+    size_t left = len;
+
+    if (c->kind == TRANSPORT_PIPE) {
+        while (left > 0) {
+            ssize_t n = write(c->fd, p, left);
+            //EINTR before the first byte: a signal (SIGTERM) stops a worker blocked on a full pipe, the frame is dropped;
+            //after a part of the frame: retry, a frame cut in the middle would corrupt the channel (frames > PIPE_BUF)
+            if (n < 0 && errno == EINTR && left < len) continue;
+            if (n <= 0) return -1;
+            p += n;
+            left -= (size_t)n;
+        }
+        return (ssize_t)len;
+    }
+
+    ShmRing *r = c->ring;
+    while (left > 0) {
+        uint64_t head = atomic_load_explicit(&r->head, memory_order_relaxed); //only this process writes head
+        size_t want = (left < RING_SIZE) ? left : RING_SIZE;
+        size_t space;
+        struct timespec t0 = {0, 0};
+        while ((space = RING_SIZE - (size_t)(head - atomic_load_explicit(&r->tail, memory_order_acquire))) < want) {
+            //full: the blackboard is behind, give up when the runtime stops or when it does not read for too long
+            //(only before the first piece: a message cut in the middle would corrupt the channel)
+            if (!runtime_running()) return -1;
+            if (left == len) {
+                struct timespec t;
+                clock_gettime(CLOCK_MONOTONIC, &t);
+                if (t0.tv_sec == 0 && t0.tv_nsec == 0) t0 = t;
+                long waited_ms = (long)(t.tv_sec - t0.tv_sec) * 1000L + (t.tv_nsec - t0.tv_nsec) / 1000000L;
+                if (waited_ms >= CHAN_FULL_WAIT_ms) {
+                    errno = ETIMEDOUT;
+                    return -1;
+                }
+            }
+            sched_yield();
+        }
+        size_t n = (left < space) ? left : space;
+
+        size_t off = head & (RING_SIZE - 1);
+        size_t first = (n < RING_SIZE - off) ? n : RING_SIZE - off;
+        memcpy(&r->data[off], p, first);
+        memcpy(&r->data[0], p + first, n - first);
+
+        atomic_store_explicit(&r->head, head + n, memory_order_release); //bytes visible
+        atomic_thread_fence(memory_order_seq_cst);
+
+        if (atomic_load_explicit(&r->tail, memory_order_relaxed) == head) { //it was empty: the blackboard may sleep
+            uint64_t one = 1;
+            if (write(c->fd, &one, sizeof(one)) < 0 && errno != EAGAIN) return -1;
+        }
+        p += n;
+        left -= n;
+    }
+    return (ssize_t)len;
+}
+
+//bytes sent and not read yet by the blackboard (ring: head - tail, pipe: FIONREAD on the write end)
+static inline uint32_t chan_pending(const Channel *c) {
+    if (c->kind == TRANSPORT_RING) {
+        uint64_t head = atomic_load_explicit(&c->ring->head, memory_order_relaxed);
+        return (uint32_t)(head - atomic_load_explicit(&c->ring->tail, memory_order_relaxed));
+    }
+    int n = 0;
+    if (c->fd < 0 || ioctl(c->fd, FIONREAD, &n) < 0) return 0;
+    return (uint32_t)n;
+}
+
+//the consumer emptied the ring: clear the notification, then check again (a message may arrive between the two)
+static inline int ring_clear(Channel *c, uint64_t tail) {
+    uint64_t cnt;
+    if (read(c->fd, &cnt, sizeof(cnt)) < 0 && errno != EAGAIN) return -1;
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&c->ring->head, memory_order_acquire) != tail) { //arrived meanwhile: wake the loop again
+        uint64_t one = 1;
+        if (write(c->fd, &one, sizeof(one)) < 0 && errno != EAGAIN) return -1;
+    }
+    return 0;
+}
+
+//read up to cap bytes without waiting (return the bytes, -1 with errno EAGAIN when there is nothing, 0 when the pipe is closed)
+static inline ssize_t chan_read_some(Channel *c, void *buf, size_t cap) {
+    if (c->kind == TRANSPORT_PIPE) return read(c->fd, buf, cap); //read end is O_NONBLOCK (chan_nonblock)
+
+    ShmRing *r = c->ring;
+    uint64_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    uint64_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+
+    size_t n = (head - tail < cap) ? (size_t)(head - tail) : cap;
+    if (n > 0) {
+        size_t off = tail & (RING_SIZE - 1);
+        size_t first = (n < RING_SIZE - off) ? n : RING_SIZE - off;
+        memcpy(buf, &r->data[off], first);
+        memcpy((unsigned char *)buf + first, &r->data[0], n - first);
+
+        tail += n;
+        atomic_store_explicit(&r->tail, tail, memory_order_release);
+        if (head != tail) return (ssize_t)n; //buffer full before the ring was empty
+    }
+
+    if (ring_clear(c, tail) < 0) return -1;
+    if (n == 0) {
+        errno = EAGAIN;
+        return -1;
+    }
+    return (ssize_t)n;
+}
+
+//the event loop must never block on a pipe (the eventfd of the ring is already non-blocking)
+static inline int chan_nonblock(Channel *c) {
+    if (c->kind != TRANSPORT_PIPE) return 0;
+    int fl = fcntl(c->fd, F_GETFL);
+    return (fl < 0) ? -1 : fcntl(c->fd, F_SETFL, fl | O_NONBLOCK);
+}
+
+//read everything available after the bytes not handled yet (return the bytes read, -1 when the pipe is closed or on error)
+static inline ssize_t chan_drain(Channel *c, ChanBatch *b) {
+    if (b->cap == 0) {
+        b->data = malloc(CHAN_BATCH_SIZE);
+        if (!b->data) return -1;
+        b->cap = CHAN_BATCH_SIZE;
+    }
+    if (b->pos > 0) { //move the partial message at the start
+        memmove(b->data, b->data + b->pos, b->len - b->pos);
+        b->len -= b->pos;
+        b->pos = 0;
+    }
+
+    ssize_t total = 0;
+    while (b->len < b->cap) {
+        ssize_t n = chan_read_some(c, b->data + b->len, b->cap - b->len);
+        if (n > 0) {
+            b->len += (size_t)n;
+            total += n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && errno == EAGAIN) break; //nothing more
+        return -1; //closed by the worker, or error
+    }
+    return total;
+}
+
+//room for a message of 'need' bytes starting at pos (the drain stops when the buffer is full)
+static inline int chan_batch_reserve(ChanBatch *b, size_t need) {
+    if (b->pos + need <= b->cap) return 0;
+    if (b->pos > 0) { //the handled bytes are dropped first
+        memmove(b->data, b->data + b->pos, b->len - b->pos);
+        b->len -= b->pos;
+        b->pos = 0;
+    }
+    if (need <= b->cap) return 0;
+
+    size_t cap = b->cap ? b->cap : CHAN_BATCH_SIZE;
+    while (cap < need) cap *= 2;
+    unsigned char *data = realloc(b->data, cap);
+    if (!data) return -1;
+    b->data = data;
+    b->cap = cap;
+    return 0;
+}
+
+static inline void chan_batch_free(ChanBatch *b) {
+    free(b->data);
+    memset(b, 0, sizeof(*b));
+}
+
+//next whole message of fixed length (return 0 when only a partial message, or nothing, is left)
+static inline int chan_batch_next(ChanBatch *b, void *msg, size_t len) {
+    if (b->len - b->pos < len) return 0;
+    memcpy(msg, b->data + b->pos, len);
+    b->pos += len;
+    return 1;
+}
+
+//close the channel (the blackboard also removes the shm)
+static inline void chan_close(Channel *c, int owner) {
+    if (c->kind == TRANSPORT_RING) {
+        munmap(c->ring, sizeof(ShmRing));
+        if (owner) shm_unlink(c->name);
+    }
+    if (c->fd >= 0) close(c->fd);
+    c->fd = -1;
+}
+
+static inline const char *chan_kind_name(const Channel *c) {
+    return c->kind == TRANSPORT_RING ? "ring" : "pipe";
+}
@@ -6,6 +6,8 @@
     - read the obstacle position from the msgObstacle and add the element on the map
     - read the target position from the msgTarget and add the element on the map
     - management the physics of the world
+    - headless mode (--headless): no ncurses and no konsole, commands from a file/socket and periodic state snapshots
+    - renderer mode (--renderer): the ncurses windows are drawn by process_renderer from the state shm
 
     - utility for the watchdog
         - create the shared memory for the watchdog (used as a heartbeat table) and the semaphore for its safety
@@ -31,46 +33,43 @@
 #include <stdint.h>
 #include <sys/wait.h>
 #include <signal.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
 
 #include "heartbeat.h"
+#include "state_shm.h"
+#include "drone_shm.h"
 #include "map.h"
+#include "camera.h"
+#include "panels.h"
+#include "perf.h"
+#include "reactor.h"
+#include "transport.h"
+#include "messages.h"
+#include "runtime.h"
+#include "rt_profile.h"
+#include "shutdown.h"
+#include "config.h"
+#include "config_reload.h"
+#include "process_drone.h"
 #include "world.h"
 #include "drone_physics.h"
 #include "logger.h"
 #include "network.h"
 
 #define LOG_PATH "logs/"
+#define SHUTDOWN_DEADLINE_ms 1000 //all the children together, then SIGKILL (less than the watchdog timeout)
+#define READY_TIMEOUT_ms 5000 //readiness barrier (the input konsole can be slow to open)
 
 
 // --------------------------------------------------------------- STRUCT
-typedef struct { //use for the input messages, x and y to divide the input force in its directions
-    char type;
-    int dx, dy;
-} msgInput;
-
-typedef struct  { //use for the drone message, x and y to check the drone position
-    char type;
-    int x, y;
-} msgDrone;
-
-typedef struct { //use for the target messages, define the number of the targets
-    char type;
-    int num;
-    Target targets[MAX_TARGETS];
-} msgTargets;
-
-typedef struct  { //use use for the obstacles messages, define the number of the obstacles
-    char type;
-    int num;
-    Obstacle obstacles[MAX_OBSTACLES];
-} msgObstacles;
-
-
-typedef enum { //use to define the game mode: soloplayer, server or client
-    MODE_SOLO = 1,
-    MODE_SERVER = 2,
-    MODE_CLIENT = 3
-} GameMode;
+typedef struct { //options from the command line
+    int headless; //no ncurses window and no konsole for the input
+    const char *commands; //headless command source: '-' (stdin), file, fifo or 'unix:<path>'
+    const char *snapshot_path; //file with the periodic state snapshot
+    int snapshot_ms; //snapshot period
+    int renderer; //draw in a separate process (process_renderer)
+} Options;
 
 typedef enum { //use for server-client type messages
     MSG_DRONE,
@@ -78,61 +77,25 @@ typedef enum { //use for server-client type messages
     MSG_UNKNOWN
 } MsgType;
 
+typedef enum { //sources of the event loop (epoll data)
+    EV_INPUT,
+    EV_DRONE,
+    EV_TARGETS,
+    EV_OBSTACLES,
+    EV_HEARTBEAT,
+    EV_RENDER,
+    EV_SIGNAL,
+    EV_CONFIG_WATCH, //inotify on the directory of parameters.config
+    EV_CONFIG_READY, //config parsed by the reload thread
+    EV_COUNT
+} EventSource;
 
-// read Config file
-static void load_config(const char *path, Config *cfg) {
+#define HB_PERIOD_ms 250 //heartbeat timer of the blackboard (watchdog timeout: 2000 ms)
 
-    memset(cfg, 0, sizeof(Config)); //initialize the byte of the message
-    
-//-------------------------------------------------------------- READ CONFIG
-
-    FILE *f = fopen(path, "r"); //read config file
-    if (!f) { //debug for the reading of the file
-        fprintf(stderr, "Error in reading parameters.config %s\n", path); 
-        fprintf(stderr, "Use default values.\n");
-        return;
-    }
-
-    //parsig: iniitalize all the variables with the value read from the config
-    char line[256];
-    while (fgets(line, sizeof(line), f)) {
-        char key[128], value[128];
-
-        if (sscanf(line, "%127[^=]=%127s", key, value) == 2) {
-            //size
-            if (!strcmp(key, "WORLD_WIDTH"))  cfg->world_width  = atoi(value);
-            else if (!strcmp(key, "WORLD_HEIGHT")) cfg->world_height = atoi(value);
-
-            //physics
-            else if (!strcmp(key, "MASS")) cfg->mass = atof(value);
-            else if (!strcmp(key, "K")) cfg->k = atof(value);
-            else if (!strcmp(key, "DT")) cfg->dt = atof(value);
-            else if (!strcmp(key, "COMMAND_FORCE")) cfg->command_force = atof(value);
-            else if (!strcmp(key, "MAX_FORCE")) cfg->max_force = atof(value);
-            else if (!strcmp(key, "RHO")) cfg->rho = atof(value);
-            else if (!strcmp(key, "ETA")) cfg->eta = atof(value);
-            else if (!strcmp(key, "ZETA")) cfg->zeta = atof(value);
-            else if (!strcmp(key, "TANGENT_GAIN")) cfg->tangent_gain = atof(value);            
-
-            //drone
-            else if (!strcmp(key, "DRONE_START_X")) cfg->drone_start_x = atoi(value);
-            else if (!strcmp(key, "DRONE_START_Y")) cfg->drone_start_y = atoi(value);
-
-            //target
-            else if (!strcmp(key, "NUM_TARGETS")) cfg->num_targets = atoi(value);
-
-            //obstacles
-            else if (!strcmp(key, "NUM_OBSTACLES")) cfg->num_obstacles = atoi(value);
-
-            //network
-            else if (!strcmp(key, "ROTATION")) cfg->rotation = atoi(value);
-        }
-    }
-
-    fclose(f);
-}
 
 //use the new parameters in the gamestate variables
+//the number of targets and obstacles changes with the next relocation of their processes (new config version),
+//TRANSPORT, PHYSICS_OWNER, RENDER_FPS and the scheduling profile are read only at the start
 void apply_new_parameters(GameState *gs, Config *cfg) {
     gs->mass = cfg->mass;
     gs->k = cfg->k;
@@ -174,21 +137,77 @@ static void on_sigint(int sig) { //handler for ctrl+c
 void print_help() {
     printf("Drone Simulator\n");
     printf("Options:\n");
-    printf("  -h, --help        Show this help message\n\n");
+    printf("  -h, --help            Show this help message\n");
+    printf("  --headless            Run without ncurses and konsole (SOLO-PLAYER mode)\n");
+    printf("  --commands <src>      Headless command source: '-' (stdin), file, fifo or unix:<path>\n");
+    printf("  --snapshot <path>     State snapshot file (default logs/state.snapshot in headless)\n");
+    printf("  --snapshot-ms <ms>    Snapshot period (default 1000 ms)\n");
+    printf("  --renderer            Draw the windows in a separate renderer process\n\n");
 
     printf("Controls:\n");
     printf("  w/e/r/s/d/f/x/c/v   Movement keys\n");
     printf("  d                   Brake\n");
+    printf("  + / -               Zoom in / out (the camera follows the drone)\n");
+    printf("  p                   Reload parameters.config\n");
     printf("  q                   Quit\n\n");
 
     printf("Signals:\n");
-    printf("  kill -SIGUSR2 <pid>   Reload configuration\n");
+    printf("  kill -SIGUSR2 <pid>   Reload configuration (also when bin/parameters.config is saved)\n");
+}
+
+//read the command line options (return -1 for the help or a wrong option)
+static int parse_options(int argc, char *argv[], Options *opt) {
+    memset(opt, 0, sizeof(*opt));
+    opt->commands = "-";
+    opt->snapshot_ms = 1000;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-h") || !strcmp(argv[i], "--help")) return -1;
+        else if (!strcmp(argv[i], "--headless")) opt->headless = 1;
+        else if (!strcmp(argv[i], "--commands") && i + 1 < argc) opt->commands = argv[++i];
+        else if (!strcmp(argv[i], "--snapshot") && i + 1 < argc) opt->snapshot_path = argv[++i];
+        else if (!strcmp(argv[i], "--snapshot-ms") && i + 1 < argc) opt->snapshot_ms = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--renderer")) opt->renderer = 1;
+        else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            return -1;
+        }
+    }
+
+    if (opt->headless && !opt->snapshot_path) opt->snapshot_path = LOG_PATH "state.snapshot";
+    if (opt->snapshot_ms <= 0) opt->snapshot_ms = 1000;
+    if (opt->headless) opt->renderer = 0; //no terminal for the renderer
+    return 0;
+}
+
+//write the state snapshot (tmp file + rename -> the readers never see a partial file)
+static void write_snapshot(const char *path, const GameState *gs, uint64_t uptime_ms) {
+    char tmp[256];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+
+    FILE *f = fopen(tmp, "w");
+    if (!f) {
+        log_message("BLACKBOARD", "ERROR: cannot write snapshot %s", tmp);
+        return;
+    }
+
+    fprintf(f, "uptime_ms=%llu\n", (unsigned long long)uptime_ms);
+    fprintf(f, "drone_x=%.3f\ndrone_y=%.3f\n", gs->drone.x, gs->drone.y);
+    fprintf(f, "drone_vx=%.3f\ndrone_vy=%.3f\n", gs->drone.vx, gs->drone.vy);
+    fprintf(f, "fx_cmd=%.3f\nfy_cmd=%.3f\n", gs->fx_cmd, gs->fy_cmd);
+    fprintf(f, "num_obstacles=%d\nnum_targets=%d\n", gs->num_obstacles, gs->num_targets);
+    fprintf(f, "targets_collected=%d\ntotal_targets=%d\n", gs->total_target_collected, gs->total_targets);
+    fprintf(f, "obstacles_hit=%d\nfence_hit=%d\n", gs->obstacles_hit_tot, gs->fence_collision_tot);
+    fprintf(f, "score=%d\n", gs->score);
+    fclose(f);
+
+    rename(tmp, path);
 }
 
 //used to correctly terminate child processes 
 static void wait_and_log(pid_t pid, const char *name) {
     int status;
-    waitpid(pid, &status, 0);
+    if (pid <= 0 || waitpid(pid, &status, 0) <= 0) return; //not started or already waited
 
     if (WIFEXITED(status)) {
         log_message("BLACKBOARD", "%s exited with code %d",
@@ -199,17 +218,47 @@ static void wait_and_log(pid_t pid, const char *name) {
     }
 }
 
-//used to avoid zombie processes
-static void wait_pid(pid_t pid, const char *name) {
-    int status;
-    if (waitpid(pid, &status, 0) > 0) {
-        if (!WIFEXITED(status)) { //if the process did not terminate correctly
-            kill(pid, SIGKILL);  
-        }
-    }
-    log_message("BLACKBOARD", "%s terminated", name);
+
+//stop a worker: SIGTERM to its process (only if started), the threaded runtime stops all the threads together
+static void stop_worker(pid_t pid) {
+    if (pid > 0) kill(pid, SIGTERM);
+#ifdef THREADED_RUNTIME
+    runtime_stop();
+#endif
 }
 
+#ifdef THREADED_RUNTIME
+//start a worker thread with the arguments of its exec: <write_fd> <shm_name> <hb_name> [extra] [--ring <shm> <eventfd>]
+//the fds are duplicated: the worker closes its own copy when it returns, like a process
+static void start_worker(const char *name, int (*entry)(int, char **), int write_fd, const Channel *ch,
+                         const char *extra1, const char *extra2) {
+    char fd_str[16], efd_str[16];
+    snprintf(fd_str, sizeof(fd_str), "%d", dup(write_fd));
+
+    char *args[12];
+    int na = 0;
+    args[na++] = (char *)name;
+    args[na++] = fd_str;
+    args[na++] = HB_SHM_NAME;
+    args[na++] = (char *)name; //name of the heartbeat slot
+    if (extra1) args[na++] = (char *)extra1;
+    if (extra2) args[na++] = (char *)extra2;
+    if (ch->kind == TRANSPORT_RING) {
+        snprintf(efd_str, sizeof(efd_str), "%d", dup(ch->fd));
+        args[na++] = "--ring";
+        args[na++] = (char *)ch->name;
+        args[na++] = efd_str;
+    }
+    args[na] = NULL;
+
+    if (runtime_spawn(name, entry, na, args) < 0) {
+        log_message("BLACKBOARD", "ERROR: cannot start the %s thread", name);
+        g_stop = 1;
+        return;
+    }
+    log_message("BLACKBOARD", "Started %s thread", name);
+}
+#endif
 
 //used to print final statistics of END-GAME
 int print_final_win(GameState *gs, pid_t pid_watchdog) {
@@ -218,55 +267,271 @@ int print_final_win(GameState *gs, pid_t pid_watchdog) {
         kill(pid_watchdog, SIGTERM);
     }
 
-    //clear the screen
-    clear(); 
-    refresh();
+    show_final_win(gs); //wait the 'e' key
+
+    return 1; //signal to stop the main loop
+}
+
+//channel of a worker: shared memory ring if requested and available, otherwise the pipe
+static void open_channel(Channel *c, int use_ring, const char *ring_name, int pipe_read_fd) {
+    if (use_ring && chan_create_ring(c, ring_name) == 0) return;
+    if (use_ring) log_message("BLACKBOARD", "WARNING: cannot create ring %s, using the pipe", ring_name);
+    chan_pipe(c, pipe_read_fd);
+}
 
-    //open final statistics window
-    WINDOW *final_win = newwin(10, 50, LINES/2 - 5, COLS/2 - 25); 
-    box(final_win, 0, 0);
+//unmap and remove the rings (the pipes are closed with the other pipes)
+static void close_rings(Channel *input, Channel *drone, Channel *targets, Channel *obstacles) {
+    Channel *all[] = {input, drone, targets, obstacles};
+    for (int i = 0; i < 4; i++) {
+        if (all[i]->kind == TRANSPORT_RING) chan_close(all[i], 1);
+        chan_pipe(all[i], -1); //closed only once
+    }
+}
 
-    wattron(final_win, COLOR_PAIR(4) | A_BOLD);
-    mvwprintw(final_win, 1, 2, "You have collected ALL THE TARGETS!");
-    wattroff(final_win, COLOR_PAIR(4) | A_BOLD);      
-    mvwprintw(final_win, 3, 2, "Final Statistics:");
-    mvwprintw(final_win, 4, 4, "Score: %d", gs->score);
-    mvwprintw(final_win, 5, 4, "Obstacles hit: %d", gs->obstacles_hit_tot);
-    mvwprintw(final_win, 6, 4, "Fence collisions: %d", gs->fence_collision_tot);
-    mvwprintw(final_win, 8, 2, "Press 'e' to exit");
-    wrefresh(final_win);
+//read every message available on a worker channel (a pipe closed by a dead worker leaves the loop)
+static size_t drain_channel(int epfd, Channel *c, ChanBatch *b, const char *name) {
+    errno = 0;
+    ssize_t n = chan_drain(c, b);
+    if (n >= 0) return (size_t)n; //bytes read (queue of the iteration in the heartbeat table)
+    log_message("BLACKBOARD", "WARNING: %s channel closed (%s)", name, errno ? strerror(errno) : "end of file");
+    reactor_del(epfd, c->fd);
+    return 0;
+}
 
-    //exit game
-    int ch;
-    do {
-    ch = getch(); 
-    } while (ch != 'e' && ch != 'E');
-    delwin(final_win);
+//next whole frame of a worker channel (a corrupted length stops reading the channel)
+static int next_frame(int epfd, Channel *c, ChanBatch *b, const char *name, MsgHeader *h, const unsigned char **payload) {
+    int r = msg_next(b, h, payload);
+    if (r >= 0) return r;
+    log_message("BLACKBOARD", "WARNING: %s channel corrupted (frame of %u bytes), no more messages read", name, h->len);
+    reactor_del(epfd, c->fd);
+    b->len = b->pos = 0;
+    return 0;
+}
 
-    return 1; //signal to stop the main loop
+//distance of the interval between two drone ticks from the period (a backlog read together counts as 0 and a period)
+static void record_tick_jitter(PerfHist *h, uint64_t *last_us, uint64_t t_us) {
+    if (*last_us != 0 && t_us >= *last_us) {
+        uint64_t interval = t_us - *last_us;
+        uint64_t period = DRONE_PERIOD_ms * 1000ULL;
+        perf_record(h, interval > period ? interval - period : period - interval);
+    }
+    *last_us = t_us;
 }
 
-void print_mode(Screen *s, GameMode mode) {
-    const char *label = NULL;
+//sequence check of a worker channel at the shutdown, then free the buffer
+static void close_batch(ChanBatch *b, const char *name) {
+    if (b->next_seq > 0) {
+        log_message("BLACKBOARD", "[PERF] %s frames: %u received, %llu missing in the sequence, buffer %zu bytes",
+                    name, b->next_seq, (unsigned long long)b->lost, b->cap);
+    }
+    chan_batch_free(b);
+}
 
-    switch (mode) {
-        case MODE_SERVER: label = "[ SERVER MODE ]"; break;
-        case MODE_CLIENT: label = "[ CLIENT MODE ]"; break;
-        case MODE_SOLO:   label = "[ SOLO MODE ]";   break;
-        default:          return;
+//options of the worker processes (the same at the start and at a restart)
+typedef struct {
+    int headless; //input: commands from the command source instead of konsole
+    const char *commands;
+    int physics; //drone: integrates the dynamics (PHYSICS_OWNER=drone)
+    const Config *cfg; //scheduling profile of the drone, fps of the renderer
+    const sigset_t *mask; //signals blocked in the children (SIGHUP and SIGUSR1)
+} WorkerOpts;
+
+static const char *worker_bin(int proc) {
+    switch (proc) {
+        case HB_PROC_INPUT: return "./build/bin/process_input";
+        case HB_PROC_DRONE: return "./build/bin/process_drone";
+        case HB_PROC_TARGETS: return "./build/bin/process_targets";
+        case HB_PROC_OBSTACLES: return "./build/bin/process_obstacles";
+        default: return "./build/bin/process_renderer";
     }
+}
 
-    int y = s->starty + s->height;
-    int x = s->startx + (s->width - strlen(label)) / 2;
+//fork and exec a worker: <write_fd> <shm_name> <hb_name> [options] [--ring <shm> <eventfd>] (renderer: state shm, fps)
+//the child closes the fds in close_fds but its write end and its eventfd
+//resume: restart by the supervisor, the blackboard keeps the targets and the obstacles of the session
+static pid_t spawn_worker(int proc, int write_fd, const Channel *ch, const int *close_fds, int nclose,
+                          const WorkerOpts *o, int resume) {
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork failed");
+        log_message("BLACKBOARD", "ERROR: fork failed for %s", hb_proc_name(proc));
+        return -1;
+    }
+    if (pid > 0) {
+        log_message("BLACKBOARD", "Forked %s process with PID=%d", hb_proc_name(proc), pid);
+        return pid;
+    }
 
-    attron(A_BOLD | COLOR_PAIR(4));
-    mvprintw(y, x, "%s", label);
-    attroff(A_BOLD | COLOR_PAIR(4));
+    //child process: pipes and rings of the others not used
+    for (int i = 0; i < nclose; i++) {
+        int fd = close_fds[i];
+        if (fd < 0 || fd == write_fd || (ch && ch->kind == TRANSPORT_RING && fd == ch->fd)) continue;
+        close(fd);
+    }
+    sigprocmask(SIG_SETMASK, o->mask, NULL); //a restart comes from the loop, where the blackboard blocks more signals
+
+    const char *hb_name = hb_proc_name(proc); //name of the heartbeat slot
+    char fd_str[16], efd_str[16], fps_str[16], panels_str[16];
+    char *args[16];
+    int na = 0;
+    if (proc == HB_PROC_RENDERER) { //it uses the terminal of the blackboard and reads the state shm
+        snprintf(fps_str, sizeof(fps_str), "%d", o->cfg->render_fps > 0 ? o->cfg->render_fps : 30);
+        snprintf(panels_str, sizeof(panels_str), "%d", o->cfg->panel_refresh_ms);
+        args[na++] = (char *)worker_bin(proc);
+        args[na++] = STATE_SHM_NAME;
+        args[na++] = HB_SHM_NAME;
+        args[na++] = (char *)hb_name;
+        args[na++] = fps_str;
+        args[na++] = panels_str;
+    } else {
+        if (proc == HB_PROC_INPUT && !o->headless) { //keyboard in its own window
+            args[na++] = "konsole";
+            args[na++] = "-e";
+        }
+        snprintf(fd_str, sizeof(fd_str), "%d", write_fd);
+        args[na++] = (char *)worker_bin(proc);
+        args[na++] = fd_str;
+        args[na++] = HB_SHM_NAME;
+        args[na++] = (char *)hb_name;
+        if (proc == HB_PROC_INPUT && o->headless) { //no konsole: commands from the command source
+            args[na++] = "--headless";
+            args[na++] = (char *)o->commands;
+        }
+        if (proc == HB_PROC_DRONE && o->physics) {
+            args[na++] = "--physics";
+            args[na++] = DRONE_SHM_NAME;
+        }
+        if (resume && (proc == HB_PROC_TARGETS || proc == HB_PROC_OBSTACLES)) args[na++] = "--resume";
+        if (ch->kind == TRANSPORT_RING) {
+            snprintf(efd_str, sizeof(efd_str), "%d", ch->fd);
+            args[na++] = "--ring";
+            args[na++] = (char *)ch->name;
+            args[na++] = efd_str;
+        }
+    }
+    args[na] = NULL;
 
-    refresh();
+    if (proc == HB_PROC_DRONE) rt_child("DRONE", o->cfg->cpu_drone, o->cfg->rt_priority, o->cfg->mlock); //kept by exec
+    execvp(args[0], args);
+    fprintf(stderr, "exec %s failed: %s\n", args[0], strerror(errno));
+    _exit(1);
 }
 
+//worker watched by the supervisor: what a restart replaces
+typedef struct {
+    pid_t *pid; //NULL: not a worker of this session
+    Channel *ch; //NULL: renderer (no channel)
+    ChanBatch *batch;
+    int *pipe; //read and write end
+    const char *ring; //name of the ring (TRANSPORT=ring)
+    uint32_t tag; //EventSource of the channel
+    int restarts;
+    uint64_t pending_us; //request of a restart not ready yet (0: none), checked by check_restarts()
+} Supervised;
+
+//supervisor: start again only the worker of a released slot, with a new channel and a new slot
+//the state of the session stays in the blackboard (targets, obstacles) and in the drone shm (drone process)
+//return -1 when the worker used all its restarts or cannot be started: the game stops
+static int restart_worker(Supervised sup[HB_PROCS], int proc, int epfd, const WorkerOpts *o) {
+    Supervised *w = &sup[proc];
+    const char *name = hb_proc_name(proc);
+    if (w->restarts >= o->cfg->restart_workers) {
+        log_message("BLACKBOARD", "[SUPERVISOR] %s failed after %d restarts (RESTART_WORKERS=%d), shutting down",
+                    name, w->restarts, o->cfg->restart_workers);
+        return -1;
+    }
+    uint64_t t0 = now_us();
 
+    //old process: already dead or killed by the watchdog (konsole exits with the input process)
+    if (*w->pid > 0) {
+        kill(*w->pid, SIGKILL);
+        wait_and_log(*w->pid, name);
+        *w->pid = -1;
+    }
+
+    //new channel: nothing of the old process is read again
+    if (w->ch) {
+        int ring = (w->ch->kind == TRANSPORT_RING);
+        reactor_del(epfd, w->ch->fd);
+        chan_close(w->ch, 1); //ring: unmapped and removed, pipe: read end closed
+        if (ring) close(w->pipe[0]);
+        if (pipe(w->pipe) == -1) {
+            perror("pipe creation failed");
+            log_message("BLACKBOARD", "[SUPERVISOR] ERROR: cannot create the pipe of %s", name);
+            w->pipe[0] = w->pipe[1] = -1;
+            return -1;
+        }
+        open_channel(w->ch, ring, w->ring, w->pipe[0]);
+        w->batch->len = w->batch->pos = 0;
+        w->batch->next_seq = 0; //the new process numbers its frames from 0
+    }
+
+    int fds[3 * HB_PROCS]; //channels of all the workers: the new one keeps only its own
+    int nfds = 0;
+    for (int p = 0; p < HB_PROCS; p++) {
+        if (!sup[p].ch) continue;
+        fds[nfds++] = sup[p].ch->fd;
+        fds[nfds++] = sup[p].pipe[0];
+        fds[nfds++] = sup[p].pipe[1];
+    }
+    pid_t pid = spawn_worker(proc, w->ch ? w->pipe[1] : -1, w->ch, fds, nfds, o, 1);
+    if (w->ch) {
+        close(w->pipe[1]);
+        w->pipe[1] = -1;
+    }
+    if (pid < 0) return -1;
+    *w->pid = pid;
+    w->restarts++;
+    if (w->ch) {
+        chan_nonblock(w->ch);
+        reactor_add(epfd, w->ch->fd, w->tag);
+    }
+
+    //not waited here: the loop goes on (ticks, channels, heartbeat of the blackboard) until the new process is ready
+    w->pending_us = t0;
+    log_message("BLACKBOARD", "[SUPERVISOR] %s restarted (PID=%d, restart %d of %d)", name, pid, w->restarts, o->cfg->restart_workers);
+    return 0;
+}
+
+//supervisor: restarted workers whose new process is ready (bit of its slot in ready_mask), checked at every iteration
+//the slot of the failed process was released, so an active slot with its name belongs to the new one
+//(the pid is not compared: with konsole the supervised pid is the one of the terminal)
+static void check_restarts(Supervised sup[HB_PROCS], const HeartbeatTable *hb) {
+    for (int p = 0; p < HB_PROCS; p++) {
+        Supervised *w = &sup[p];
+        if (!w->pending_us) continue;
+
+        const char *name = hb_proc_name(p);
+        int slot = hb_find(hb, name);
+        uint64_t waited_us = now_us() - w->pending_us;
+        if (slot >= 0 && (atomic_load(&hb->ready_mask) & (1u << slot))) {
+            log_message("BLACKBOARD", "[SUPERVISOR] %s ready (PID=%d) %.1fms after the request", name, hb_pid(hb, slot), waited_us / 1000.0);
+        } else if (waited_us >= READY_TIMEOUT_ms * 1000ULL) {
+            log_message("BLACKBOARD", "[SUPERVISOR] WARNING: %s restarted but not ready after %dms", name, READY_TIMEOUT_ms);
+        } else {
+            continue; //not ready yet
+        }
+        w->pending_us = 0;
+    }
+}
+
+//publish the gamestate for the renderer process and the monitors (written in place under the seqlock)
+static void publish_state(StateShm *state, const GameState *gs, GameMode mode, const HeartbeatTable *hb, const PerfSummary *perf,
+                          uint64_t physics_ticks, int running, int game_over) {
+    StateSnapshot *snap = state_write_begin(state);
+
+    snap->tick++;
+    snap->physics_ticks = physics_ticks;
+    snap->publish_us = now_us();
+    snap->running = running;
+    snap->game_over = game_over;
+    snap->mode = mode;
+    hb_proc_pids(hb, snap->pids);
+    snap->gs = *gs;
+    snap->perf = *perf;
+
+    state_write_end(state);
+}
 
 //message type for the comunication server-client
 MsgType parse_message_type(const char *s) {
@@ -279,11 +544,51 @@ MsgType parse_message_type(const char *s) {
 
 int main(int argc, char *argv[])
 {  
+    uint64_t boot_us = now_us(); //time to first frame
     GameMode mode = MODE_SOLO; //default game mode
     NetworkContext ctx;
     int network=0;
     memset(&ctx, 0, sizeof(ctx));
+
+    //helper and options
+    Options opt;
+    if (parse_options(argc, argv, &opt) < 0) {
+        print_help();
+        return 0;
+    }
+    int headless = opt.headless;
+    int draw = !headless && !opt.renderer; //the blackboard uses ncurses
+    int st_fd = -1; //state shm (renderer process and monitors)
+    StateShm *state = NULL;
+    DroneShm *dshm = NULL; //drone shm (PHYSICS_OWNER=drone)
+    ConfigShm *cshm = NULL; //config shm (copied by the children)
+    PerfStats perf; //live statistics (overlay)
+    perf_stats_init(&perf);
+    Channel ch_input, ch_drone, ch_targets, ch_obstacles; //messages of the workers (pipe or ring)
+    chan_pipe(&ch_input, -1);
+    chan_pipe(&ch_drone, -1);
+    chan_pipe(&ch_targets, -1);
+    chan_pipe(&ch_obstacles, -1);
+
+    //everything released by the cleanup label: initialized before the first 'goto cleanup'
+    int hb_fd = -1; //heartbeat table
+    HeartbeatTable *hb = NULL;
+    int pipe_input[2] = {-1, -1};
+    int pipe_drone[2] = {-1, -1};
+    int pipe_obstacles[2] = {-1, -1}; //conditional pipes (not used in network mode)
+    int pipe_targets[2] = {-1, -1};
+    pid_t pid_input = -1; //process not alive yet
+    pid_t pid_drone = -1;
+    pid_t pid_targets = -1;
+    pid_t pid_obstacles = -1;
+    pid_t pid_watchdog = -1;
+    pid_t pid_renderer = -1;
     
+    if (headless) { //no terminal to ask the mode
+        log_message("BLACKBOARD", "[BOOT] Session started in HEADLESS SOLO-PLAYER mode");
+        goto mode_selected;
+    }
+
     printf("Select the Network mode:\n");
     printf("> '1' network disabled | SOLO-PLAYER modality\n");
     printf("> '2' network enabled | SERVER or CLIENT modality\n");
@@ -340,6 +645,8 @@ int main(int argc, char *argv[])
         printf("--help to see the help commands\n");
     }
 
+mode_selected:
+
     static int bb_log_counter = 0; //to avoid the child log write on the initial log
 
     //log and setup watchdog
@@ -350,7 +657,10 @@ int main(int argc, char *argv[])
 
     //parameters -------------------------------------------------------------------
     Config cfg;
-    load_config("bin/parameters.config", &cfg);
+    if (config_load(CONFIG_PATH, &cfg) < 0) { //parsed only here, the children copy it from the config shm
+        fprintf(stderr, "Error in reading parameters.config %s\n", CONFIG_PATH);
+        fprintf(stderr, "Use default values.\n");
+    }
     switch (cfg.rotation) {
         case 0:   ctx.rotation = ROT_0; break;
         case 90:  ctx.rotation = ROT_90; break;
@@ -364,89 +674,87 @@ int main(int argc, char *argv[])
                 cfg.world_width, cfg.world_height, cfg.num_obstacles, cfg.num_targets, bb_log_counter++);    
     }
     
-    //helper
-    if (argc > 1 && (!strcmp(argv[1], "-h") || !strcmp(argv[1], "--help"))) {
-        print_help();
-        return 0;
-    }
-    
     //ncurses -----------------------------------------------------------------
-    initscr(); //initialize
-    int old_lines = LINES;
-    int old_cols  = COLS;
-
-    start_color();
-    //yellow target
-    init_pair(1, COLOR_YELLOW, COLOR_BLACK);
-    //magenta obstacles
-    init_pair(2, COLOR_MAGENTA, COLOR_BLACK);
-    //green drone
-    init_pair(3, COLOR_GREEN, COLOR_BLACK);
-    //cyan color
-    init_pair(4, COLOR_CYAN, COLOR_BLACK); 
-
-    noecho();
-    curs_set(0);
+    int old_lines = 0;
+    int old_cols  = 0;
     srand(time(NULL));
 
-    if (mode == MODE_CLIENT) {
-        char ip_address[64];
+    Screen screen; //initialize the screen 
+    Panels panels; //inspection windows
+
+    if (draw) {
+        initscr(); //initialize
+#ifdef THREADED_RUNTIME
+        cbreak(); //the input thread reads the keys of this terminal one by one
+        noecho();
+#endif
+        old_lines = LINES;
+        old_cols  = COLS;
+
+        start_color();
+        //yellow target
+        init_pair(1, COLOR_YELLOW, COLOR_BLACK);
+        //magenta obstacles
+        init_pair(2, COLOR_MAGENTA, COLOR_BLACK);
+        //green drone
+        init_pair(3, COLOR_GREEN, COLOR_BLACK);
+        //cyan color
+        init_pair(4, COLOR_CYAN, COLOR_BLACK); 
+
+        noecho();
+        curs_set(0);
 
-        while (1) {
-            clear();
-            mvprintw(5, 2, "CLIENT MODE");
-            mvprintw(7, 2, "Insert server IP address:");
-            mvprintw(8, 2, "(Press 's' to switch to SOLO-PLAYER)");
-            mvprintw(10, 2, "> ");
-            refresh();
+        if (mode == MODE_CLIENT) {
+            char ip_address[64];
+
+            while (1) {
+                clear();
+                mvprintw(5, 2, "CLIENT MODE");
+                mvprintw(7, 2, "Insert server IP address:");
+                mvprintw(8, 2, "(Press 's' to switch to SOLO-PLAYER)");
+                mvprintw(10, 2, "> ");
+                refresh();
+
+                echo();
+                getnstr(ip_address, 63);
+                log_message("BLACKBOARD", "[CLIENT] ip addres insert: %s", ip_address);
+                noecho();
+
+                if (strcmp(ip_address, "s") == 0 || strcmp(ip_address, "S") == 0) {
+                    network = 0;
+                    mode = MODE_SOLO;
+                    break;
+                }
 
-            echo();
-            getnstr(ip_address, 63);
-            log_message("BLACKBOARD", "[CLIENT] ip addres insert: %s", ip_address);
-            noecho();
+                if (strlen(ip_address) < 7 || strlen(ip_address) > 63) {
+                    mvprintw(12, 2, "Invalid IP. Press any key to retry.");
+                    getch();
+                    continue;
+                }
 
-            if (strcmp(ip_address, "s") == 0 || strcmp(ip_address, "S") == 0) {
-                network = 0;
-                mode = MODE_SOLO;
-                break;
-            }
+                strcpy(ctx.server_ip, ip_address);
 
-            if (strlen(ip_address) < 7 || strlen(ip_address) > 63) {
-                mvprintw(12, 2, "Invalid IP. Press any key to retry.");
-                getch();
-                continue;
+                clear();
+                refresh();
+                break;
             }
+        }
 
-            strcpy(ctx.server_ip, ip_address);
+        //create windows ----------------------------------------------------------------
+        init_screen(&screen, network);
+        print_mode(&screen, mode);
 
-            clear();
-            refresh();
-            break;
+        //create the inspection window
+        init_panels(&panels, cfg.panel_refresh_ms);
+    } else if (opt.renderer && mode == MODE_CLIENT) { //the terminal is used by the renderer later: ask the ip now
+        printf("\nCLIENT MODE\nInsert server IP address:\n> ");
+        if (scanf("%63s", ctx.server_ip) != 1) {
+            network = 0;
+            mode = MODE_SOLO;
         }
+        log_message("BLACKBOARD", "[CLIENT] ip addres insert: %s", ctx.server_ip);
     }
 
-    //create windows ----------------------------------------------------------------
-    Screen screen; //initialize the screen 
-    init_screen(&screen, network);
-    print_mode(&screen, mode);
-
-    //create the inspection window
-    WINDOW *info_win = newwin(8, 40, 0, 2); //info window
-    box(info_win, 0, 0);
-    mvwprintw(info_win, 0, 2, "[ Info ]");
-
-    WINDOW *processes_win = newwin(6, 40, 0, 60); //processes pid window
-    box(processes_win, 0, 0);
-    mvwprintw(processes_win, 0, 2, "[ Processes ]");
-
-    WINDOW *collision_win = newwin(5, 40, 8, 2); //collision window
-    box(collision_win, 0, 0);
-    mvwprintw(collision_win, 0, 2, "[ Collisions ]");
-
-    WINDOW *help_win = newwin(5, 40, 8, 60); //help window
-    box(help_win, 0, 0);
-    mvwprintw(help_win, 0, 2, "[ Help  ]");
-
 
     //initialize the variables of the gamestate struct --------------------------------
     GameState gs; 
@@ -456,11 +764,16 @@ int main(int argc, char *argv[])
     //initializate SERVER
     if (mode == MODE_SERVER) { 
         //window area
-        clear();
-        attron(A_BOLD | COLOR_PAIR(1));
-        mvprintw(LINES/2, (COLS - 25)/2, "Waiting for a client...");
-        attroff(A_BOLD | COLOR_PAIR(1));
-        refresh();
+        if (draw) {
+            clear();
+            attron(A_BOLD | COLOR_PAIR(1));
+            mvprintw(LINES/2, (COLS - 25)/2, "Waiting for a client...");
+            attroff(A_BOLD | COLOR_PAIR(1));
+            refresh();
+        } else {
+            printf("Waiting for a client...\n");
+            fflush(stdout);
+        }
 
         ctx.role = NET_SERVER;
         ctx.port = DEFAULT_PORT;
@@ -468,9 +781,11 @@ int main(int argc, char *argv[])
         // initializate socket
         network_server_init(&ctx);
         
-        clear();
-        refresh();
-        print_mode(&screen, mode);
+        if (draw) {
+            clear();
+            refresh();
+            print_mode(&screen, mode);
+        }
 
         // handshake
         if (server_handshake(&ctx) < 0) {
@@ -508,7 +823,7 @@ int main(int argc, char *argv[])
 
     // SHM ----------------------------------------------------------------------------------------------------------------------
     //create shared memory
-    int hb_fd = shm_open(HB_SHM_NAME, O_CREAT | O_RDWR, 0666);
+    hb_fd = shm_open(HB_SHM_NAME, O_CREAT | O_RDWR, 0666);
     if (hb_fd < 0) { 
         perror("shm_open"); 
         goto cleanup;
@@ -521,30 +836,70 @@ int main(int argc, char *argv[])
     }
 
     //mapping shm to the memory address
-    HeartbeatTable *hb = mmap(NULL, sizeof(HeartbeatTable), PROT_READ | PROT_WRITE, MAP_SHARED, hb_fd, 0);
+    hb = mmap(NULL, sizeof(HeartbeatTable), PROT_READ | PROT_WRITE, MAP_SHARED, hb_fd, 0);
     if (hb == MAP_FAILED) { 
         perror("mmap"); 
+        hb = NULL;
         goto cleanup;
     }
 
-    //initialize the heartbeat table to zero
+    //initialize the heartbeat table to zero (slots without lock, layout of this build)
     memset(hb, 0, sizeof(*hb));
+    hb_init(hb);
 
-    //initialize the semaphore
-    if (sem_init(&hb->mutex, 1, 1) == -1) {  //(mutex, shared between processes, initial value)
+    //initialize the semaphore of the readiness barrier
+    if (sem_init(&hb->ready, 1, 0) == -1) {  //(semaphore, shared between processes, initial value)
         perror("sem_init");
         goto cleanup;
     }
-    log_message("BLACKBOARD", "[BOOT] Heartbeat semaphore initialized", bb_log_counter++);
+    log_message("BLACKBOARD", "[BOOT] Heartbeat table initialized (layout %d, %d slots)", HB_LAYOUT_VERSION, HB_MAX_SLOTS);
 
-    struct timespec ts = {0, 200 * 1000 * 1000};  //delay for wait the log to write in the system.log (200ms)
-    nanosleep(&ts, NULL);
+    //config shm: the children copy the Config instead of parsing the file (version 1, +1 for every reload)
+    cshm = config_shm_create();
+    if (!cshm) {
+        perror("config shm");
+        goto cleanup;
+    }
+    config_publish(cshm, &cfg);
 
-    //save in the blackboard info in its heartbeat slot ---------------------------------
-    sem_wait(&hb->mutex); //lock the heartbeat table
-    hb->entries[HB_SLOT_BLACKBOARD].pid = getpid();
-    hb->entries[HB_SLOT_BLACKBOARD].last_seen_ms = now_ms(); //tells the watchdog it is stil active
-    sem_post(&hb->mutex); //unlock the heartbeat table
+    //state shm for the renderer process and the monitors (build/bin/state_monitor)
+    st_fd = shm_open(STATE_SHM_NAME, O_CREAT | O_RDWR, 0666);
+    if (st_fd < 0 || ftruncate(st_fd, sizeof(StateShm)) < 0) {
+        perror("state shm"); 
+        goto cleanup;
+    }
+    state = mmap(NULL, sizeof(StateShm), PROT_READ | PROT_WRITE, MAP_SHARED, st_fd, 0);
+    if (state == MAP_FAILED) { 
+        perror("state mmap"); 
+        state = NULL;
+        goto cleanup;
+    }
+    memset(state, 0, sizeof(*state));
+    publish_state(state, &gs, mode, hb, &perf.summary, 0, 1, 0); //first snapshot before the renderer starts
+
+    //drone shm: the drone process integrates the dynamics, the blackboard sends commands and obstacles
+    if (cfg.physics_drone) {
+        int d_fd = shm_open(DRONE_SHM_NAME, O_CREAT | O_RDWR, 0666);
+        if (d_fd < 0 || ftruncate(d_fd, sizeof(DroneShm)) < 0) {
+            perror("drone shm");
+            if (d_fd >= 0) close(d_fd);
+            goto cleanup;
+        }
+        dshm = mmap(NULL, sizeof(DroneShm), PROT_READ | PROT_WRITE, MAP_SHARED, d_fd, 0);
+        close(d_fd);
+        if (dshm == MAP_FAILED) {
+            perror("drone mmap");
+            dshm = NULL;
+            goto cleanup;
+        }
+        memset(dshm, 0, sizeof(*dshm));
+        drone_publish_env(dshm, &gs);
+        drone_result_from_state(&dshm->res, &gs); //start position of the drone process
+    }
+    log_message("BLACKBOARD", "[BOOT] Drone dynamics integrated by the %s", dshm ? "drone process" : "blackboard");
+
+    //save in the blackboard info in its heartbeat slot (first claim: HB_SLOT_BLACKBOARD) ---------------
+    hb_claim(hb, hb_proc_name(HB_PROC_BLACKBOARD), getpid(), HB_PERIOD_ms, 0);
 
     //signal handlers ----------------------------------------------------------------
     //handler to sigusr1 (watchdog request to stop)
@@ -580,12 +935,6 @@ int main(int argc, char *argv[])
     sigaddset(&mask, SIGHUP);
     sigaddset(&mask, SIGUSR1);
 
-    // define the pipes
-    int pipe_input[2];
-    int pipe_drone[2];
-    int pipe_obstacles[2] = {-1, -1}; //conditional pipes (not used in network mode)
-    int pipe_targets[2] = {-1, -1};
-    
     //check pipes creation 
     if (pipe(pipe_input) == -1) {
         perror("pipe creation failed");
@@ -611,12 +960,21 @@ int main(int argc, char *argv[])
         }
     }
 
-    //initialize pid (process not alive yet)
-    pid_t pid_input = -1;
-    pid_t pid_drone = -1;
-    pid_t pid_targets = -1;
-    pid_t pid_obstacles = -1;
-    pid_t pid_watchdog = -1;
+    //channels of the workers: shared memory ring + eventfd, the pipe is the fallback
+    open_channel(&ch_input, cfg.transport_ring, "/ring_input", pipe_input[0]);
+    open_channel(&ch_drone, cfg.transport_ring, "/ring_drone", pipe_drone[0]);
+    if(network==0){
+        open_channel(&ch_targets, cfg.transport_ring, "/ring_targets", pipe_targets[0]);
+        open_channel(&ch_obstacles, cfg.transport_ring, "/ring_obstacles", pipe_obstacles[0]);
+    }
+    log_message("BLACKBOARD", "[BOOT] Worker transport: %s", chan_kind_name(&ch_drone), bb_log_counter++);
+
+    //fds closed by every child (its own write end and eventfd excluded) and options of the worker processes
+    int boot_fds[] = {pipe_input[0], pipe_input[1], pipe_drone[0], pipe_drone[1],
+                      pipe_targets[0], pipe_targets[1], pipe_obstacles[0], pipe_obstacles[1],
+                      ch_input.fd, ch_drone.fd, ch_targets.fd, ch_obstacles.fd};
+    int nboot_fds = sizeof(boot_fds) / sizeof(boot_fds[0]);
+    WorkerOpts wopts = { headless, opt.commands, dshm != NULL, &cfg, &mask };
 
     if (sigprocmask(SIG_BLOCK, &mask, NULL) == -1) { //active mask to avoid wrong signals
         perror("sigprocmask");
@@ -624,132 +982,48 @@ int main(int argc, char *argv[])
     }
     log_message("BLACKBOARD", "[BOOT] Signal mask active", bb_log_counter++);
 
-    //input
-    pid_input = fork();
-    if(pid_input < 0) { // error
-        perror("fork failed for process_input");
-        log_message("BLACKBOARD", "ERROR: fork failed for INPUT");
+    //restart requests of the watchdog: read by the loop (signalfd), never the default action (it would terminate)
+    sigset_t restart_sig;
+    sigemptyset(&restart_sig);
+    sigaddset(&restart_sig, HB_SIG_RESTART);
+    sigprocmask(SIG_BLOCK, &restart_sig, NULL);
+
+    uint64_t fork_us = now_us(); //start of the children (readiness barrier)
+#ifdef THREADED_RUNTIME
+    //workers as threads of the blackboard: same main and same arguments of the processes
+    start_worker("INPUT", input_main, pipe_input[1], &ch_input,
+                 "--headless", opt.commands ? opt.commands : "-"); //keys from the command source or from this terminal
+    start_worker("DRONE", drone_main, pipe_drone[1], &ch_drone,
+                 dshm ? "--physics" : NULL, dshm ? DRONE_SHM_NAME : NULL);
+    if(network==0){
+        start_worker("TARGETS", targets_main, pipe_targets[1], &ch_targets, NULL, NULL);
+        start_worker("OBSTACLES", obstacles_main, pipe_obstacles[1], &ch_obstacles, NULL, NULL);
+
+        char *wd_args[] = {"WATCHDOG", HB_SHM_NAME, "2000", NULL}; // 2s timeout
+        if (runtime_spawn("WATCHDOG", watchdog_main, 3, wd_args) < 0) g_stop = 1;
+    }
+    if (g_stop) {
+        log_message("BLACKBOARD", "Thread start failed, skipping main loop");
+        goto cleanup;
+    }
+    log_message("BLACKBOARD", "All worker threads started");
+#else
+    //input, drone, targets and obstacles: every child keeps only the write end of its own channel
+    if ((pid_input = spawn_worker(HB_PROC_INPUT, pipe_input[1], &ch_input, boot_fds, nboot_fds, &wopts, 0)) < 0) {
         g_stop = 1;
         exit(1);
-    } else if (pid_input == 0){ //child process of the input process
-        //pipes not used
-        close(pipe_input[0]); 
-        close(pipe_drone[0]);
-        close(pipe_drone[1]);
-        if(network==0){
-            close(pipe_targets[0]);
-            close(pipe_targets[1]);
-            close(pipe_obstacles[0]);
-            close(pipe_obstacles[1]);
-        }
-
-        char fd_str[16];
-        snprintf(fd_str, sizeof(fd_str), "%d", pipe_input[1]);
-
-        char slot_str[8]; //used for the watchdog processes
-        snprintf(slot_str, sizeof(slot_str), "%d", HB_SLOT_INPUT);
-        execlp("konsole", "konsole", "-e", "./build/bin/process_input",
-            fd_str, HB_SHM_NAME, slot_str, (char *)NULL);
-        perror("execlp process_input failed");
-        _exit(1);
-    } else {
-        log_message("BLACKBOARD", "Forked INPUT process with PID=%d", pid_input);
     }
-
-    // drone
-    pid_drone = fork();
-    if(pid_drone < 0){ //error
-        perror("fork failed for process_drone");
-        log_message("BLACKBOARD", "ERROR: fork failed for DRONE");
+    if ((pid_drone = spawn_worker(HB_PROC_DRONE, pipe_drone[1], &ch_drone, boot_fds, nboot_fds, &wopts, 0)) < 0) {
         g_stop = 1;
         exit(1);
-    } else if(pid_drone == 0){ //child process of the drone process
-        //pipes not used
-        close(pipe_drone[0]);
-        close(pipe_input[0]);
-        close(pipe_input[1]);
-        if(network==0)
-        {
-            close(pipe_targets[0]);
-            close(pipe_targets[1]);
-            close(pipe_obstacles[0]);
-            close(pipe_obstacles[1]);
-        }
-
-        char fd_str[16];
-        snprintf(fd_str, sizeof(fd_str), "%d", pipe_drone[1]);
-        
-        char slot_str[8]; //used for the watchdog processes
-        snprintf(slot_str, sizeof(slot_str), "%d", HB_SLOT_DRONE);
-        execlp("./build/bin/process_drone", "./build/bin/process_drone",
-            fd_str, HB_SHM_NAME, slot_str, (char *)NULL);
-        perror("execlp process_drone failed");
-        _exit(1);
-    } else {
-        log_message("BLACKBOARD", "Forked DRONE process with PID=%d", pid_drone);
     }
 
     if(network==0){
-       // target
-        pid_targets = fork();
-        if(pid_targets < 0){ //error
-            perror("fork failed for process_targets");
-            log_message("BLACKBOARD", "ERROR: fork failed for TARGETS");
+        pid_targets = spawn_worker(HB_PROC_TARGETS, pipe_targets[1], &ch_targets, boot_fds, nboot_fds, &wopts, 0);
+        pid_obstacles = spawn_worker(HB_PROC_OBSTACLES, pipe_obstacles[1], &ch_obstacles, boot_fds, nboot_fds, &wopts, 0);
+        if (pid_targets < 0 || pid_obstacles < 0) {
             g_stop = 1;
             exit(1);
-        } else if (pid_targets == 0) { //child process of the targets process
-            //pipes not used
-            close(pipe_targets[0]); //use only pipe_targets[1] for the tick
-            close(pipe_input[0]);
-            close(pipe_input[1]);
-            close(pipe_drone[0]);
-            close(pipe_drone[1]);
-            close(pipe_obstacles[0]);
-            close(pipe_obstacles[1]);
-
-            char fd_str[16];
-            snprintf(fd_str, sizeof(fd_str), "%d", pipe_targets[1]);
-            
-            char slot_str[8];
-            snprintf(slot_str, sizeof(slot_str), "%d", HB_SLOT_TARGETS);
-
-            execlp("./build/bin/process_targets", "./build/bin/process_targets",
-                fd_str, HB_SHM_NAME, slot_str, (char*)NULL);
-
-            perror("execlp process_targets failed");
-            _exit(1);
-        } else {
-            log_message("BLACKBOARD", "Forked TARGETS process with PID=%d", pid_targets);
-        }
-        
-        // obstacles
-        pid_obstacles = fork();
-        if(pid_obstacles < 0){ //error
-            perror("fork failed for process_obstacles");
-            log_message("BLACKBOARD", "ERROR: fork failed for OBSTACLES");
-            g_stop = 1;
-            exit(1);
-        } else if(pid_obstacles == 0){ //child process of the obstacles process
-            //pipes not used
-            close(pipe_obstacles[0]); //use only pipe_obstacles[1] for the tick
-            close(pipe_input[0]);
-            close(pipe_input[1]);
-            close(pipe_drone[0]);
-            close(pipe_drone[1]);
-            close(pipe_targets[0]);
-            close(pipe_targets[1]);
-            char fd_str[16];
-            snprintf(fd_str, sizeof(fd_str), "%d", pipe_obstacles[1]);
-            
-            char slot_str[8]; //used for the watchdog processes
-            snprintf(slot_str, sizeof(slot_str), "%d", HB_SLOT_OBSTACLES);
-            execlp("./build/bin/process_obstacles", "./build/bin/process_obstacles",
-                fd_str, HB_SHM_NAME, slot_str, (char *)NULL);
-
-            perror("execlp process_obstacles failed");
-            _exit(1);
-        } else {
-            log_message("BLACKBOARD", "Forked OBSTACLES process with PID=%d", pid_obstacles);
         }
 
         if (g_stop) {
@@ -771,42 +1045,75 @@ int main(int argc, char *argv[])
             char timeout_str[16];
             snprintf(timeout_str, sizeof(timeout_str), "%d", 2000); // 2s timeout
 
+            rt_child("WATCHDOG", cfg.cpu_watchdog, cfg.rt_priority, cfg.mlock); //kept by exec
             execlp("./build/bin/watchdog",  "./build/bin/watchdog",
-                HB_SHM_NAME, timeout_str, (char *)NULL);
+                HB_SHM_NAME, timeout_str, cfg.restart_workers > 0 ? "--supervise" : NULL, (char *)NULL);
 
             perror("execlp watchdog failed");
             _exit(1);
         }
     }
 
+#endif
+
+    //renderer
+    if (opt.renderer && (pid_renderer = spawn_worker(HB_PROC_RENDERER, -1, NULL, boot_fds, nboot_fds, &wopts, 0)) < 0) {
+        g_stop = 1;
+        exit(1);
+    }
+
+    //readiness barrier: every child mapped the heartbeat table and opened its channel (no fixed sleep)
+    int expected = 2; //input and drone
+    if (network == 0) expected += 2; //targets and obstacles
+    if (opt.renderer) expected++;
+    int missing = hb_wait_ready(hb, expected, READY_TIMEOUT_ms);
+    if (missing) log_message("BLACKBOARD", "[BOOT] WARNING: %d of %d processes not ready after %dms, starting anyway",
+                             missing, expected, READY_TIMEOUT_ms);
+    else log_message("BLACKBOARD", "[BOOT] All children ready %.1fms after the first fork", (now_us() - fork_us) / 1000.0);
+    atomic_store(&hb->boot_mask, atomic_load(&hb->ready_mask) | (1u << HB_SLOT_BLACKBOARD)); //the watchdog starts checking
+    int first_frame = 1;
+
     sigprocmask(SIG_UNBLOCK, &mask, NULL); //deactive signalmask 
     log_message("BLACKBOARD", "[BOOT] Signal mask deactive", bb_log_counter++);
 
     //close write 
     close(pipe_input[1]);
     close(pipe_drone[1]);
+    pipe_input[1] = pipe_drone[1] = -1; //a restart must not close them again
     if(network==0){
         close(pipe_obstacles[1]);
         close(pipe_targets[1]);
+        pipe_obstacles[1] = pipe_targets[1] = -1;
+    }
+
+    //every wake-up reads all the pending messages of a channel: the reads must not block
+    static ChanBatch batch_input, batch_drone, batch_targets, batch_obstacles;
+    chan_nonblock(&ch_input);
+    chan_nonblock(&ch_drone);
+    if(network==0){
+        chan_nonblock(&ch_targets);
+        chan_nonblock(&ch_obstacles);
     }
 
     // READ MESSAGES -------------------------------------------------------------
     if(network==0)
     {
+        MsgHeader h;
+        const unsigned char *payload;
+
         // messagge by process_obstacles
-        msgObstacles msg_obstacles;
-        ssize_t n = read(pipe_obstacles[0], &msg_obstacles, sizeof(msg_obstacles));
-        if (n == sizeof(msg_obstacles) && msg_obstacles.type == 'O') { //define the obstacle as 'O'
-            gs.num_obstacles = msg_obstacles.num;
-            if (gs.num_obstacles > MAX_OBSTACLES) gs.num_obstacles = MAX_OBSTACLES;
-
-            for (int i = 0; i < gs.num_obstacles; i++) { //loop to associate every obstacle to its (x,y) coordinates
-                gs.obstacles[i].x = msg_obstacles.obstacles[i].x;
-                gs.obstacles[i].y = msg_obstacles.obstacles[i].y;
-            }
+        //bounded wait: a worker that died or hangs before its first frame leaves the map without obstacles/targets
+        int r = msg_recv_wait(&ch_obstacles, &batch_obstacles, pipe_obstacles[0], READY_TIMEOUT_ms, &g_stop, &h, &payload);
+        if (r <= 0) log_message("BLACKBOARD", "WARNING: no obstacles from the worker (%s), starting with 0",
+                                r == 0 ? "timeout" : "worker stopped");
+        if (r > 0 && h.type == 'O') { //define the obstacle as 'O'
+            int n = msg_list(&h, payload, gs.obstacles, sizeof(Obstacle), MAX_OBSTACLES); //entries copied in the game state
+            gs.num_obstacles = (n < MAX_OBSTACLES) ? n : MAX_OBSTACLES;
+            if (n > MAX_OBSTACLES) log_message("BLACKBOARD", "WARNING: %d obstacles received, the map keeps %d", n, MAX_OBSTACLES);
         } else {
             gs.num_obstacles = 0;
         }
+        gs.obstacles_rev++;
         // position check
         for (int i = 0; i < gs.num_obstacles; i++) {
             if (gs.obstacles[i].x == gs.drone.x && gs.obstacles[i].y == gs.drone.y) {
@@ -815,16 +1122,15 @@ int main(int argc, char *argv[])
         }
         
         // massage by process_targets 
-        msgTargets msg_t;
-        ssize_t nt = read(pipe_targets[0], &msg_t, sizeof(msg_t));
-
-        if (nt == sizeof(msg_t) && msg_t.type == 'T') { //define the target as 'T'
-            gs.num_targets = msg_t.num;
-            if (gs.num_targets > MAX_TARGETS) gs.num_targets = MAX_TARGETS;
-
-            for (int i = 0; i < gs.num_targets; i++) { //loop to associate every target to its (x,y) coordinates
-                gs.targets[i].x = msg_t.targets[i].x;
-                gs.targets[i].y = msg_t.targets[i].y;
+        r = msg_recv_wait(&ch_targets, &batch_targets, pipe_targets[0], READY_TIMEOUT_ms, &g_stop, &h, &payload);
+        if (r <= 0) log_message("BLACKBOARD", "WARNING: no targets from the worker (%s), starting with 0",
+                                r == 0 ? "timeout" : "worker stopped");
+        if (r > 0 && h.type == 'T') { //define the target as 'T'
+            int n = msg_list(&h, payload, gs.targets, sizeof(Target), MAX_TARGETS);
+            gs.num_targets = (n < MAX_TARGETS) ? n : MAX_TARGETS;
+            if (n > MAX_TARGETS) {
+                log_message("BLACKBOARD", "WARNING: %d targets received, the map keeps %d", n, MAX_TARGETS);
+                gs.total_targets = MAX_TARGETS; //the targets not kept cannot be collected
             }
         } else {
             gs.num_targets = 0;
@@ -842,17 +1148,82 @@ int main(int argc, char *argv[])
         }
     }
 
-    // SELECT---------------------------------------------------------------
+    // EVENT LOOP (epoll) ------------------------------------------------------
 
-    fd_set set; //define set of the file to 'listen'
-    //select the number of descriptor
-    int maxfd = pipe_input[0];
-    if (pipe_drone[0] > maxfd) maxfd = pipe_drone[0];
+    //scheduling profile of the tick path: after the forks, so the other children keep the normal scheduler
+    rt_apply("BLACKBOARD", cfg.cpu_blackboard, cfg.rt_priority);
+    if (cfg.mlock) rt_mlock("BLACKBOARD");
+
+    int epfd = reactor_create();
+    if (epfd < 0) {
+        perror("epoll_create1");
+        goto cleanup;
+    }
+    reactor_add(epfd, ch_input.fd, EV_INPUT); //pipe read end or eventfd of the ring
+    reactor_add(epfd, ch_drone.fd, EV_DRONE);
     if(network==0){
-        if (pipe_obstacles[0] > maxfd) maxfd = pipe_obstacles[0];
-        if (pipe_targets[0] > maxfd) maxfd = pipe_targets[0];
+        reactor_add(epfd, ch_targets.fd, EV_TARGETS);
+        reactor_add(epfd, ch_obstacles.fd, EV_OBSTACLES);
+    }
+
+    //heartbeat timer (the slot is refreshed also without messages)
+    ReactorTimer hb_timer = { .fd = -1 };
+    if (network==0 && reactor_timer(&hb_timer, HB_PERIOD_ms) >= 0) reactor_add(epfd, hb_timer.fd, EV_HEARTBEAT);
+
+    //render timer: the map is drawn at RENDER_FPS, not at every message
+    ReactorTimer render_timer = { .fd = -1 };
+    if (draw) {
+        int fps = cfg.render_fps > 0 ? cfg.render_fps : 30;
+        if (reactor_timer(&render_timer, 1000 / fps) >= 0) reactor_add(epfd, render_timer.fd, EV_RENDER);
     }
-    maxfd += 1;
+
+    //shutdown, reload and restart signals: read in the loop (blocked only now, the children are already forked)
+    int loop_signals[] = {SIGUSR1, SIGINT, SIGUSR2, SIGHUP, HB_SIG_RESTART};
+    int sfd = reactor_signals(loop_signals, network == 0 ? 5 : 3); //SIGHUP and the supervisor only in solo mode
+    if (sfd >= 0) reactor_add(epfd, sfd, EV_SIGNAL);
+    else perror("signalfd");
+
+    //hot reload of the config: parsed by its thread, applied between two physics ticks
+    static ConfigReload reload;
+    static Config reload_cfg; //parsed config waiting for the next tick
+    int reload_pending = 0;
+    uint64_t reload_request_us = 0, reload_parse_us = 0;
+    if (reload_start(&reload, CONFIG_PATH, config_load) == 0) {
+        if (reload.watch_fd >= 0) reactor_add(epfd, reload.watch_fd, EV_CONFIG_WATCH);
+        reactor_add(epfd, reload.ready_fd, EV_CONFIG_READY);
+    } else {
+        log_message("BLACKBOARD", "WARNING: cannot start the config reload thread");
+    }
+
+    //input merged between two physics ticks
+    InputAccum pending_input;
+    memset(&pending_input, 0, sizeof(pending_input));
+    PerfHist input_delay; //arrival of the first command -> tick that applies it
+    perf_reset(&input_delay);
+    uint64_t input_commands = 0, input_ticks = 0;
+    uint64_t physics_ticks = 0; //published in the state shm
+    uint64_t drone_steps = 0; //PHYSICS_OWNER=drone: steps of the drone process already read
+    uint64_t cmd_sent = 0, cmd_first_us = 0; //commands sent to the drone process, first one not applied yet
+    uint64_t input_sent_us = 0, cmd_sent_us = 0; //send time of the oldest command not applied (latency trace)
+    PerfHist tick_jitter_send, tick_jitter_recv; //|interval - DRONE_PERIOD_ms| between two drone ticks: sent by the drone, read here
+    perf_reset(&tick_jitter_send);
+    perf_reset(&tick_jitter_recv);
+    uint64_t last_tick_sent_us = 0, last_tick_recv_us = 0;
+    unsigned drone_env_rev = gs.obstacles_rev; //obstacles sent to the drone process
+
+    //supervisor: workers restarted alone when the watchdog releases their slot (RESTART_WORKERS)
+    Supervised sup[HB_PROCS];
+    memset(sup, 0, sizeof(sup));
+    sup[HB_PROC_INPUT] = (Supervised){ &pid_input, &ch_input, &batch_input, pipe_input, "/ring_input", EV_INPUT, 0, 0 };
+    sup[HB_PROC_DRONE] = (Supervised){ &pid_drone, &ch_drone, &batch_drone, pipe_drone, "/ring_drone", EV_DRONE, 0, 0 };
+    sup[HB_PROC_TARGETS] = (Supervised){ &pid_targets, &ch_targets, &batch_targets, pipe_targets, "/ring_targets", EV_TARGETS, 0, 0 };
+    sup[HB_PROC_OBSTACLES] = (Supervised){ &pid_obstacles, &ch_obstacles, &batch_obstacles, pipe_obstacles, "/ring_obstacles",
+                                           EV_OBSTACLES, 0, 0 };
+    sup[HB_PROC_RENDERER] = (Supervised){ &pid_renderer, NULL, NULL, NULL, NULL, 0, 0, 0 };
+    uint32_t restart_mask = 0; //workers to restart at the end of this iteration
+
+    uint64_t start_ms = now_ms(); //used for the snapshots
+    uint64_t last_snapshot_ms = 0;
 
     while (1){
 
@@ -865,72 +1236,216 @@ int main(int argc, char *argv[])
             break;
         }
 
-        if(network==0){ 
-            sem_wait(&hb->mutex); //lock the heartbeat table
-            hb->entries[HB_SLOT_BLACKBOARD].last_seen_ms = now_ms();  //reflesh the slot (for the wathcdog) every iteration - it is indipendent from pipes
-            sem_post(&hb->mutex); //unlock the heartbeat table
+        struct epoll_event events[EV_COUNT];
+        int rc = epoll_wait(epfd, events, EV_COUNT, -1); //only timers, pipes and signals wake up the loop
+        if (rc < 0) {
+            if (errno == EINTR) continue;   // resize
+                perror("epoll_wait");
+                break;
+        }
+        uint64_t wake_us = now_us(); //loop latency: from here to the end of the iteration
+        size_t loop_bytes = 0; //bytes of the workers waiting at the wake-up
+        perf_count_wakeup(&perf);
+
+        //ready sources
+        int ready[EV_COUNT] = {0};
+        for (int i = 0; i < rc; i++) ready[events[i].data.u32] = 1;
+
+        // SIGNALS
+        if (ready[EV_SIGNAL]) {
+            int sig, value;
+            while ((sig = reactor_signal_info(sfd, &value)) > 0) {
+                if (sig == SIGUSR2) {
+                    reload_request(&reload, "SIGUSR2");
+                    continue;
+                }
+                if (sig == HB_SIG_RESTART) { //after the messages of this iteration: a quit sent before the exit is read first
+                    if (value > HB_PROC_BLACKBOARD && value < HB_PROCS && sup[value].pid && *sup[value].pid > 0) {
+                        log_message("BLACKBOARD", "[SUPERVISOR] restart of %s requested by the watchdog", hb_proc_name(value));
+                        restart_mask |= 1u << value;
+                    }
+                    continue;
+                }
+                if (sig == SIGINT) log_message("BLACKBOARD", "received SIGINT (Ctrl+C), shutting down");
+                else if (sig == SIGHUP) log_message("BLACKBOARD", "window closed: received SIGHUP");
+                g_stop = 1; //SIGUSR1: watchdog request
+            }
+            if (g_stop) continue; //the check at the top of the loop logs and exits
         }
 
-        FD_ZERO(&set);
-        FD_SET(pipe_input[0], &set);
-        FD_SET(pipe_drone[0], &set);
-        if(network==0){
-            FD_SET(pipe_obstacles[0], &set);
-            FD_SET(pipe_targets[0], &set);
+        // CONFIG - file saved: the reload thread parses it, the loop only copies the result
+        if (ready[EV_CONFIG_WATCH]) reload_watch(&reload);
+        if (ready[EV_CONFIG_READY]) {
+            uint64_t req_us, parse_us;
+            if (reload_take(&reload, &reload_cfg, &req_us, &parse_us)) {
+                if (config_valid(&reload_cfg)) {
+                    reload_pending = 1;
+                    reload_request_us = req_us;
+                    reload_parse_us = parse_us;
+                } else {
+                    log_message("BLACKBOARD", "[RELOAD] WARNING: parameters.config not valid (size, mass or dt), not applied");
+                }
+            }
         }
 
-        //timer to update the heartbeat - small timeout for a periodic refresh
-        struct timeval tv;
-        tv.tv_sec = 0;
-        tv.tv_usec = 100000; // 100 ms
+        // HEARTBEAT
+        if (ready[EV_HEARTBEAT]) {
+            uint64_t late;
+            if (reactor_timer_fire(&hb_timer, wake_us, &late)) {
+                perf_dispatch(&perf, late);
+                hb_beat(hb, HB_SLOT_BLACKBOARD);  //reflesh the slot (for the wathcdog) - it is indipendent from pipes
+            }
+        }
 
-        int rc = select(maxfd, &set, NULL, NULL, &tv); //listen to all the set of processes
-        if (rc < 0) {
-            if (errno == EINTR) continue;   // resize
-                perror("select");
-                break;
+        // RENDER - only flag the frame, it is drawn at the end of the iteration
+        int render_due = 0;
+        if (ready[EV_RENDER]) {
+            uint64_t late;
+            if (reactor_timer_fire(&render_timer, wake_us, &late)) {
+                perf_dispatch(&perf, late);
+                render_due = 1;
+            }
         }
 
-        // INPUT 
-        if (FD_ISSET(pipe_input[0], &set)) {
-            msgInput m;
-            ssize_t ri = read(pipe_input[0], &m, sizeof(m));         
-            if (ri != sizeof(m)) continue;  //error of reading
+        int changed = (mode != MODE_SOLO); //state to publish (network: updated at every iteration)
+
+        // INPUT - all the keys pressed since the last wake-up
+        int quit = 0;
+        if (ready[EV_INPUT]) {
+            loop_bytes += drain_channel(epfd, &ch_input, &batch_input, "input");
+            uint64_t recv_us = now_us();
+            MsgHeader h;
+            const unsigned char *payload;
+            uint64_t nmsg = 0;
+            while (!quit && next_frame(epfd, &ch_input, &batch_input, "input", &h, &payload)) {
+                nmsg++;
+                perf_count_msg(&perf, PERF_PIPE_INPUT);
+                msgInput m = {0, 0};
+                msg_copy(&h, payload, &m, sizeof(m));
+                perf_trace_received(&perf, PERF_PIPE_INPUT, h.sent_us, recv_us);
               
-            if (m.type == 'Q') {
-                if (mode == MODE_SERVER) send_quit(&ctx); //send quit message to client if server mode
+                if (h.type == 'Q') {
+                    if (mode == MODE_SERVER) send_quit(&ctx); //send quit message to client if server mode
 
-                log_message("BLACKBOARD", "Quit: shutting down");
+                    log_message("BLACKBOARD", "Quit: shutting down");
                 
-                //kills exist processes
-                kill(pid_input, SIGTERM);
-                kill(pid_drone, SIGTERM);
-                if(network==0){
-                    kill(pid_targets, SIGTERM);
-                    kill(pid_obstacles, SIGTERM);
-                    kill(pid_watchdog, SIGTERM);
+                    //kills exist processes
+                    if(network==0) stop_worker(pid_watchdog); //first the watchdog: its pidfds see the others exit
+                    stop_worker(pid_input);
+                    stop_worker(pid_drone);
+                    if (pid_renderer > 0) kill(pid_renderer, SIGTERM);
+                    if(network==0){
+                        stop_worker(pid_targets);
+                        stop_worker(pid_obstacles);
+                    }
+                    quit = 1;
+                } else if (h.type == 'I' || h.type == 'B') {  //direction or brake: applied all together at the next physics tick
+                    input_accumulate(&pending_input, h.type, m.dx, m.dy, wake_us);
+                    if (input_sent_us == 0) input_sent_us = h.sent_us;
+                }
+                else if (h.type == 'V') {  //performance overlay
+                    gs.overlay = !gs.overlay;
+                    perf_trace_applied(&perf, PERF_PIPE_INPUT, h.sent_us, now_us());
+                }
+                else if (h.type == 'Z') {  //camera zoom
+                    gs.zoom += m.dx;
+                    if (gs.zoom < 0) gs.zoom = 0;
+                    if (gs.zoom > ZOOM_LEVELS - 1) gs.zoom = ZOOM_LEVELS - 1;
+                    perf_trace_applied(&perf, PERF_PIPE_INPUT, h.sent_us, now_us());
+                } else if (h.type == 'P') { //read parameters (in the reload thread)
+                    reload_request(&reload, "'P' key");
                 }
-                break; //quit
-            } else if (m.type == 'I') {  //direction: separation in x and y
-                int mx = m.dx;
-                int my = m.dy;
-                add_direction(&gs, mx, my); //use to compute the input force in the pshysics process
             }
-            else if (m.type == 'B') {  //brake
-                use_brake(&gs);
-            }/* else if (m.type == 'P'){ //read parameters
-                load_config("bin/parameters.config", &cfg);
-                apply_new_parameters(&gs, &cfg);
-            }*/
+            perf_count_batch(&perf, PERF_PIPE_INPUT, nmsg);
+            if (nmsg > 0) changed = 1;
+
+            if (dshm && pending_input.commands > 0) { //the drone process applies them at its next step
+                if (cmd_first_us == 0) {
+                    cmd_first_us = pending_input.first_us;
+                    cmd_sent_us = input_sent_us;
+                }
+                input_sent_us = 0;
+                input_commands += pending_input.commands;
+                cmd_sent += pending_input.commands;
+                drone_publish_commands(dshm, pending_input.commands, pending_input.brake, pending_input.mx, pending_input.my);
+                memset(&pending_input, 0, sizeof(pending_input));
+            }
         }
+        if (quit) break; //quit
+
+        // DRONE - drone dynamics, one step for every tick (a backlog is integrated before the next frame)
+        if(ready[EV_DRONE]){
+            loop_bytes += drain_channel(epfd, &ch_drone, &batch_drone, "drone");
+            uint64_t recv_us = now_us();
+            MsgHeader h;
+            const unsigned char *payload;
+            uint64_t nmsg = 0, step_sent_us = 0;
+            while (dshm && next_frame(epfd, &ch_drone, &batch_drone, "drone", &h, &payload)) { //integrated by the drone: only the notification
+                nmsg++;
+                perf_count_msg(&perf, PERF_PIPE_DRONE);
+                perf_trace_received(&perf, PERF_PIPE_DRONE, h.sent_us, recv_us);
+                if (step_sent_us == 0) step_sent_us = h.sent_us;
+                record_tick_jitter(&tick_jitter_send, &last_tick_sent_us, h.sent_us);
+                record_tick_jitter(&tick_jitter_recv, &last_tick_recv_us, recv_us);
+            }
+            if (dshm && nmsg > 0) {
+                static DroneResult res; //latest step of the drone process
+                drone_seq_read(&dshm->res_seq, &res, &dshm->res, sizeof(res));
+                for (uint64_t i = drone_steps; i < res.steps; i++) perf_count_tick(&perf);
+                physics_ticks += res.steps - drone_steps;
+                drone_steps = res.steps;
+
+                drone_result_to_state(&gs, &res);
+                drone_target_collide(&gs);
+                uint64_t t = now_us();
+                perf_trace_applied(&perf, PERF_PIPE_DRONE, step_sent_us, t); //steps of the drone process in the game state
+                if (cmd_first_us != 0 && res.commands >= cmd_sent) { //all the commands sent are applied
+                    perf_trace_applied(&perf, PERF_PIPE_INPUT, cmd_sent_us, t);
+                    perf_record(&input_delay, t - cmd_first_us);
+                    input_ticks++;
+                    cmd_first_us = 0;
+                }
+            }
+            while (next_frame(epfd, &ch_drone, &batch_drone, "drone", &h, &payload)) { //timer callout: update the drone dynamics
+                nmsg++;
+                perf_count_msg(&perf, PERF_PIPE_DRONE);
+                perf_trace_received(&perf, PERF_PIPE_DRONE, h.sent_us, recv_us);
+                record_tick_jitter(&tick_jitter_send, &last_tick_sent_us, h.sent_us);
+                record_tick_jitter(&tick_jitter_recv, &last_tick_recv_us, recv_us);
+
+                uint64_t first_us = pending_input.first_us;
+                int applied = apply_input(&gs, &pending_input); //commands since the previous tick
+                if (applied > 0) {
+                    uint64_t t = now_us();
+                    perf_trace_applied(&perf, PERF_PIPE_INPUT, input_sent_us, t); //add_direction of the oldest command
+                    input_sent_us = 0;
+                    perf_record(&input_delay, t - first_us);
+                    input_commands += applied;
+                    input_ticks++;
+                }
+                add_drone_dynamics(&gs); 
+                perf_trace_applied(&perf, PERF_PIPE_DRONE, h.sent_us, now_us());
+                drone_target_collide(&gs); //at every step: a backlog does not jump over the target
+                perf_count_tick(&perf);
+                physics_ticks++;
+            }
+            perf_count_batch(&perf, PERF_PIPE_DRONE, nmsg);
+            if (nmsg > 0) changed = 1;
 
-        // DRONE - drone dynamics
-        if(FD_ISSET(pipe_drone[0], &set)){
-            msgDrone m;
-            ssize_t rd= read(pipe_drone[0], &m, sizeof(m));         //timer callout: update the drone dynamics
-            if (rd != sizeof(m)) continue;  //error of reading
-            
-            add_drone_dynamics(&gs); 
+            //CONFIG - a parsed config is applied after the steps of this tick: no step sees half of it
+            if (reload_pending && nmsg > 0) {
+                uint64_t t0 = now_us();
+                cfg = reload_cfg;
+                apply_new_parameters(&gs, &cfg);
+                if (dshm) drone_publish_env(dshm, &gs); //the drone process uses it from its next step
+                config_publish(cshm, &cfg); //new version: targets and obstacles copy it and resize
+                uint64_t t1 = now_us();
+                log_message("BLACKBOARD", "[RELOAD] config version %u applied after tick %llu: parse %lluus (reload thread), apply %lluus, request -> applied %.1fms",
+                            config_version(cshm), (unsigned long long)physics_ticks, (unsigned long long)reload_parse_us,
+                            (unsigned long long)(t1 - t0), (t1 - reload_request_us) / 1000.0);
+                reload_pending = 0;
+                changed = 1;
+            }
         }
 
         //SERVER - network communication
@@ -964,6 +1479,7 @@ int main(int argc, char *argv[])
             convert_from_virtual(oxv, oyv, &ox, &oy, gs.world_width, gs.world_height, ctx.rotation);
 
             //update obstacle position
+            if (gs.num_obstacles != 1 || gs.obstacles[0].x != ox || gs.obstacles[0].y != oy) gs.obstacles_rev++;
             gs.num_obstacles = 1;
             gs.obstacles[0].x = ox;
             gs.obstacles[0].y = oy;
@@ -1005,6 +1521,7 @@ int main(int argc, char *argv[])
                     convert_from_virtual(vx, vy, &rx, &ry, gs.world_width, gs.world_height, ctx.rotation);
 
                     //update obstacle position
+                    if (gs.num_obstacles != 1 || gs.obstacles[0].x != rx || gs.obstacles[0].y != ry) gs.obstacles_rev++;
                     gs.num_obstacles = 1;
                     gs.obstacles[0].x = rx;
                     gs.obstacles[0].y = ry;
@@ -1039,65 +1556,103 @@ int main(int argc, char *argv[])
             }             
 
             //draw map
-            render(&screen, &gs);
+            if (draw) render(&screen, &gs);
         }
 
         if(network==0){
             // TARGET - respawn
-            if (FD_ISSET(pipe_targets[0], &set)) {
-                msgTargets mt;
-                ssize_t nr = read(pipe_targets[0], &mt, sizeof(mt)); //timer callout: change targets position
-                if (nr != sizeof(mt)) continue; //error of reading
-
-                if (mt.type == 'R') {
-                    int remains_target = mt.num;
-                    if (remains_target > gs.num_targets) {
-                        remains_target = gs.num_targets; // relocation of the remains targets. They should be the same for architecture choices
-                    }
-                    for (int i = 0; i < remains_target; i++) {
-                        gs.targets[i] = mt.targets[i]; //new vector for the remains targets 
-                    }
-                    log_message("BLACKBOARD", "Target remaining: %d", remains_target);
+            if (ready[EV_TARGETS]) {
+                loop_bytes += drain_channel(epfd, &ch_targets, &batch_targets, "targets");
+                uint64_t recv_us = now_us();
+                MsgHeader h;
+                const unsigned char *payload;
+                uint64_t nmsg = 0;
+                while (next_frame(epfd, &ch_targets, &batch_targets, "targets", &h, &payload)) { //timer callout: change targets position
+                    nmsg++;
+                    perf_count_msg(&perf, PERF_PIPE_TARGETS);
+                    perf_trace_received(&perf, PERF_PIPE_TARGETS, h.sent_us, recv_us);
+
+                    if (h.type == 'R') {
+                        //new vector for the remains targets (copied in the game state)
+                        int remains_target = msg_list(&h, payload, gs.targets, sizeof(Target), MAX_TARGETS);
+                        if (remains_target > MAX_TARGETS) {
+                            log_message("BLACKBOARD", "WARNING: %d targets received, the map keeps %d", remains_target, MAX_TARGETS);
+                            remains_target = MAX_TARGETS;
+                        }
+                        if (remains_target != gs.num_targets) { //NUM_TARGETS changed by a config reload
+                            gs.num_targets = remains_target;
+                            gs.total_targets = remains_target > gs.current_target_index ? remains_target : gs.current_target_index;
+                            log_message("BLACKBOARD", "[RELOAD] targets resized to %d", remains_target);
+                        }
+                        log_message("BLACKBOARD", "Target remaining: %d", remains_target);
                     
-                    //check overlap with obstacles
-                    for (int i = 0; i < remains_target; i++) {
-                        for (int j = 0; j < gs.num_obstacles; j++) {
-                            if (gs.targets[i].x == gs.obstacles[j].x && gs.targets[i].y == gs.obstacles[j].y) {
-                                respawn_target(&gs, i);
-                                break;
+                        //check overlap with obstacles
+                        for (int i = 0; i < remains_target; i++) {
+                            for (int j = 0; j < gs.num_obstacles; j++) {
+                                if (gs.targets[i].x == gs.obstacles[j].x && gs.targets[i].y == gs.obstacles[j].y) {
+                                    respawn_target(&gs, i);
+                                    break;
+                                }
                             }
                         }
+                        perf_trace_applied(&perf, PERF_PIPE_TARGETS, h.sent_us, now_us());
                     }
                 }
+                perf_count_batch(&perf, PERF_PIPE_TARGETS, nmsg);
+                if (nmsg > 0) changed = 1;
             }
 
             // OBSTACLES - respawn
-            if (FD_ISSET(pipe_obstacles[0], &set)) {
-                msgObstacles mo;
-                ssize_t no = read(pipe_obstacles[0], &mo, sizeof(mo)); //timer callout: change obstacles position
-                if (no != sizeof(mo)) continue; //error of reading
-
-                if (mo.type == 'R') {                
-                    int n = mo.num;
-                    if (n > gs.num_obstacles) {
-                        n = gs.num_obstacles; // relocation of the obstacles
-                    }
-                    
-                    for (int i = 0; i < n; i++) { //new vector of obstacles used for the respawn
-                        gs.obstacles[i] = mo.obstacles[i]; 
-                    }
+            if (ready[EV_OBSTACLES]) {
+                loop_bytes += drain_channel(epfd, &ch_obstacles, &batch_obstacles, "obstacles");
+                uint64_t recv_us = now_us();
+                MsgHeader h;
+                const unsigned char *payload;
+                uint64_t nmsg = 0;
+                while (next_frame(epfd, &ch_obstacles, &batch_obstacles, "obstacles", &h, &payload)) { //timer callout: change obstacles position
+                    nmsg++;
+                    perf_count_msg(&perf, PERF_PIPE_OBSTACLES);
+                    perf_trace_received(&perf, PERF_PIPE_OBSTACLES, h.sent_us, recv_us);
+
+                    if (h.type == 'R') {                
+                        //new vector of obstacles used for the respawn (copied in the game state)
+                        int n = msg_list(&h, payload, gs.obstacles, sizeof(Obstacle), MAX_OBSTACLES);
+                        if (n > MAX_OBSTACLES) {
+                            log_message("BLACKBOARD", "WARNING: %d obstacles received, the map keeps %d", n, MAX_OBSTACLES);
+                            n = MAX_OBSTACLES;
+                        }
+                        if (n != gs.num_obstacles) { //NUM_OBSTACLES changed by a config reload
+                            log_message("BLACKBOARD", "[RELOAD] obstacles resized to %d", n);
+                            gs.num_obstacles = n;
+                        }
+                        gs.obstacles_rev++;
 
-                    //check position
-                    for (int i = 0; i < n; i++) {
-                        //no overlap with drone
-                        if (gs.obstacles[i].x == (int)gs.drone.x && gs.obstacles[i].y == (int)gs.drone.y) {
-                            respawn_obstacle(&gs, i);
+                        //check position
+                        for (int i = 0; i < n; i++) {
+                            //no overlap with drone
+                            if (gs.obstacles[i].x == (int)gs.drone.x && gs.obstacles[i].y == (int)gs.drone.y) {
+                                respawn_obstacle(&gs, i);
+                            }
                         }
+                        perf_trace_applied(&perf, PERF_PIPE_OBSTACLES, h.sent_us, now_us());
                     }
                 }
+                perf_count_batch(&perf, PERF_PIPE_OBSTACLES, nmsg);
+                if (nmsg > 0) changed = 1;
             }
         }
 
+        //SUPERVISOR - failed workers started again, the others and the game state are not touched
+        int supervisor_stop = 0;
+        for (int p = 0; restart_mask && p < HB_PROCS; p++) {
+            if (!(restart_mask & (1u << p))) continue;
+            restart_mask &= ~(1u << p);
+            if (restart_worker(sup, p, epfd, &wopts) < 0) supervisor_stop = 1;
+            changed = 1;
+        }
+        if (supervisor_stop) break;
+        check_restarts(sup, hb);
+
         //check position - respect of the map border 
         if (gs.drone.x < 0) gs.drone.x = 0;
         if (gs.drone.y < 0) gs.drone.y = 0;
@@ -1105,15 +1660,22 @@ int main(int argc, char *argv[])
         if (gs.drone.y >= gs.world_height) gs.drone.y = gs.world_height - 1;
 
         //resize
-        if (LINES != old_lines || COLS != old_cols) {
+        if (draw && (LINES != old_lines || COLS != old_cols)) {
             old_lines = LINES;
             old_cols  = COLS;
             refresh_screen(&screen, network);
             print_mode(&screen, mode);
+            invalidate_panels(&panels);
         }
 
         drone_target_collide(&gs); //manages the collision
         calculate_final_score(&gs); //update scoreù
+
+        //periodic state snapshot
+        if (opt.snapshot_path && now_ms() - last_snapshot_ms >= (uint64_t)opt.snapshot_ms) {
+            last_snapshot_ms = now_ms();
+            write_snapshot(opt.snapshot_path, &gs, last_snapshot_ms - start_ms);
+        }
             
         //END-GAME
         if(network==0){
@@ -1121,11 +1683,25 @@ int main(int argc, char *argv[])
                 log_message("BLACKBOARD", "All targets collected");
 
                 //kills exist processes
-                kill(pid_watchdog, SIGTERM); //first kill watchdog to avoid wrong sigusr1
-                kill(pid_input, SIGTERM); 
-                kill(pid_drone, SIGTERM); 
-                kill(pid_targets, SIGTERM); 
-                kill(pid_obstacles, SIGTERM); 
+                stop_worker(pid_watchdog); //first kill watchdog to avoid wrong sigusr1
+                stop_worker(pid_input); 
+                stop_worker(pid_drone); 
+                stop_worker(pid_targets); 
+                stop_worker(pid_obstacles); 
+
+                if (headless) { //no window: final statistics in the log and in the snapshot
+                    log_message("BLACKBOARD", "Final statistics: score=%d obstacles_hit=%d fence_hit=%d",
+                                gs.score, gs.obstacles_hit_tot, gs.fence_collision_tot);
+                    break;
+                }
+
+                if (opt.renderer) { //the renderer shows the final statistics: wait until it exits
+                    publish_state(state, &gs, mode, hb, &perf.summary, physics_ticks, 1, 1);
+                    log_message("BLACKBOARD", "Final statistics in the renderer");
+                    wait_and_log(pid_renderer, "RENDERER");
+                    g_stop = 1;
+                    break;
+                }
 
                 log_message("BLACKBOARD", "Open the final statistics");
                 g_stop = print_final_win(&gs, pid_watchdog); //call function to print final statistics
@@ -1135,71 +1711,113 @@ int main(int argc, char *argv[])
             }
         }
 
+        //obstacles changed: new environment for the drone process
+        if (dshm && gs.obstacles_rev != drone_env_rev) {
+            drone_publish_env(dshm, &gs);
+            drone_env_rev = gs.obstacles_rev;
+        }
+
+        if (perf_stats_roll(&perf, now_ms())) changed = 1; //summary of the last second
+        if (state && changed) {
+            publish_state(state, &gs, mode, hb, &perf.summary, physics_ticks, 1, 0); //the readers take it at their own pace
+            if (!draw) perf_trace_shown(&perf, now_us()); //no window: the published state is what the readers show
+            if (!draw && first_frame) {
+                first_frame = 0;
+                log_message("BLACKBOARD", "[BOOT] time to first state published: %.1fms", (now_us() - boot_us) / 1000.0);
+            }
+        }
+        if (!draw || !render_due) { //nothing to draw
+            hb_loop(hb, HB_SLOT_BLACKBOARD, now_us() - wake_us, (uint32_t)loop_bytes);
+            perf_loop_done(&perf, wake_us);
+            continue;
+        }
+
+        perf_render_begin(&perf);
         render(&screen, &gs);
             
         if(network==0){
             //debug - print inspection windows
-            werase(info_win);
-            box(info_win, 0, 0);
-            mvwprintw(info_win, 0, 2, "[ Info ]");
-            mvwprintw(info_win, 1, 2, "Cmd: fx=%.2f fy=%.2f", gs.fx_cmd, gs.fy_cmd);
-            mvwprintw(info_win, 2, 2, "Obst: fx=%.2f fy=%.2f", gs.fx_obst, gs.fy_obst);
-            mvwprintw(info_win, 3, 2, "Fence: fx=%.2f fy=%.2f", gs.fx_fence, gs.fy_fence);
-            mvwprintw(info_win, 4, 2, "Vel: vx=%.2f vy=%.2f", gs.drone.vx, gs.drone.vy);
-            mvwprintw(info_win, 5, 2, "Pos: x=%.2f y=%.2f", gs.drone.x, gs.drone.y);
-            mvwprintw(info_win, 6, 2, "Targets: %d/%d", gs.total_target_collected, gs.total_targets);
-            wrefresh(info_win);
-
-            werase(processes_win);
-            box(processes_win, 0, 0);
-            mvwprintw(processes_win, 0, 2, "[ Processes ]");
-            mvwprintw(processes_win, 1, 2, "Input PID: %d", hb->entries[HB_SLOT_INPUT].pid); 
-            mvwprintw(processes_win, 2, 2, "Drone PID: %d", hb->entries[HB_SLOT_DRONE].pid); 
-            mvwprintw(processes_win, 3, 2, "Targets PID: %d", hb->entries[HB_SLOT_TARGETS].pid); 
-            mvwprintw(processes_win, 4, 2, "Obstacles PID: %d", hb->entries[HB_SLOT_OBSTACLES].pid); 
-            wrefresh(processes_win);
-
-            werase(collision_win);
-            box(collision_win, 0, 0);
-            mvwprintw(collision_win, 0, 2, "[ Collisions ]");
-            mvwprintw(collision_win, 1, 2, "Obstacles hit: %d", gs.obstacles_hit_tot); 
-            mvwprintw(collision_win, 2, 2, "Fence hit: %d", gs.fence_collision_tot); 
-            mvwprintw(collision_win, 3, 2, "Score: %d", gs.score);
-            wrefresh(collision_win);
-
-            werase(help_win);
-            box(help_win, 0, 0);
-            mvwprintw(help_win, 0, 2, "[ Help ]");
-            mvwprintw(help_win, 1,2, "Run 'make help' in the terminal");
-            mvwprintw(help_win, 2,2, "to see all available commands."); 
-            wrefresh(help_win);
-        }
-    }
+            pid_t pids[HB_PROCS];
+            hb_proc_pids(hb, pids);
+            draw_panels(&panels, &gs, pids);
 
-    if (g_stop == 1 || g_sighup){ //normal shutdown
-        //kills exist processes
-        kill(pid_input, SIGTERM);
-        kill(pid_drone, SIGTERM);
-        if(network==0){
-            kill(pid_targets, SIGTERM);
-            kill(pid_obstacles, SIGTERM);
-            kill(pid_watchdog, SIGTERM);
+            //performance overlay (key 'o')
+            set_overlay(&panels, gs.overlay);
+            draw_overlay(&panels, &perf.summary);
         }
+        perf_render_end(&perf);
+        if (first_frame) {
+            first_frame = 0;
+            log_message("BLACKBOARD", "[BOOT] time to first frame: %.1fms", (now_us() - boot_us) / 1000.0);
+        }
+        hb_loop(hb, HB_SLOT_BLACKBOARD, now_us() - wake_us, (uint32_t)loop_bytes);
+        perf_loop_done(&perf, wake_us);
     }
 
-    //wait for child processes to terminate
-    wait_and_log(pid_input, "INPUT");
-    wait_and_log(pid_drone, "DRONE");
-    if(network==0){
-        wait_and_log(pid_targets, "TARGETS");
-        wait_and_log(pid_obstacles, "OBSTACLES");
-        wait_and_log(pid_watchdog, "WATCHDOG");
+    if (opt.snapshot_path) write_snapshot(opt.snapshot_path, &gs, now_ms() - start_ms); //final state
+
+    //close the event loop
+    reload_stop(&reload);
+    if (hb_timer.fd >= 0) close(hb_timer.fd);
+    if (render_timer.fd >= 0) close(render_timer.fd);
+    if (sfd >= 0) close(sfd);
+    close(epfd);
+
+    uint64_t shutdown_us = now_us();
+#ifdef THREADED_RUNTIME
+    runtime_join(); //worker threads
+#endif
+    //SIGTERM to all the children together (again for who got it at the quit), wait them in parallel until the deadline
+    ChildProc children[] = {
+        {network == 0 ? pid_watchdog : 0, "WATCHDOG"}, //first the watchdog: no wrong SIGUSR1 while the others stop
+        {pid_input, "INPUT"},
+        {pid_drone, "DRONE"},
+        {pid_renderer, "RENDERER"},
+        {network == 0 ? pid_targets : 0, "TARGETS"},
+        {network == 0 ? pid_obstacles : 0, "OBSTACLES"},
+    };
+    shutdown_children(children, sizeof(children) / sizeof(children[0]), SIGTERM, SHUTDOWN_DEADLINE_ms);
+
+    if (draw) {
+        endwin();
+        camera_free(&screen.cam);
+        report_panels(&panels, "BLACKBOARD");
     }
-
-    endwin();
+    perf_stats_log(&perf, "BLACKBOARD");
+    perf_log(&input_delay, "BLACKBOARD", "input (first command to physics tick)");
+    log_message("BLACKBOARD", "[PERF] input: %llu commands applied in %llu ticks",
+                (unsigned long long)input_commands, (unsigned long long)input_ticks);
+    perf_log(&tick_jitter_send, "BLACKBOARD", "drone tick jitter (send, |interval - period|)");
+    perf_log(&tick_jitter_recv, "BLACKBOARD", "drone tick jitter (read by the blackboard, |interval - period|)");
+    perf_stats_close(&perf);
+    close_batch(&batch_input, "input");
+    close_batch(&batch_drone, "drone");
+    close_batch(&batch_targets, "targets");
+    close_batch(&batch_obstacles, "obstacles");
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    log_message("BLACKBOARD", "[UI] cpu time: user=%ld.%03lds sys=%ld.%03lds",
+                (long)ru.ru_utime.tv_sec, (long)ru.ru_utime.tv_usec / 1000,
+                (long)ru.ru_stime.tv_sec, (long)ru.ru_stime.tv_usec / 1000);
+    getrusage(RUSAGE_CHILDREN, &ru); //workers as processes (the threads are in the line above)
+    log_message("BLACKBOARD", "[PERF] children cpu time: user=%ld.%03lds sys=%ld.%03lds",
+                (long)ru.ru_utime.tv_sec, (long)ru.ru_utime.tv_usec / 1000,
+                (long)ru.ru_stime.tv_sec, (long)ru.ru_stime.tv_usec / 1000);
 
     //clanup SHM ----------------------------------------------------------------------------------------------------------------
-    sem_destroy(&hb->mutex); //destroy the semaphore    
+    close_rings(&ch_input, &ch_drone, &ch_targets, &ch_obstacles);
+    if (state) {
+        publish_state(state, &gs, mode, hb, &perf.summary, physics_ticks, 0, 0); //the monitors still mapping it see the end
+        munmap(state, sizeof(*state));
+        close(st_fd);
+        shm_unlink(STATE_SHM_NAME);
+    }
+    if (dshm) {
+        munmap(dshm, sizeof(*dshm));
+        shm_unlink(DRONE_SHM_NAME);
+    }
+    config_shm_close(cshm, 1);
+    sem_destroy(&hb->ready); //destroy the semaphore
     munmap(hb, sizeof(*hb));
     close(hb_fd);
     shm_unlink(HB_SHM_NAME);
@@ -1211,7 +1829,7 @@ int main(int argc, char *argv[])
         log_message("NETWORK", "Server connection closed");
     }
 
-    log_message("BLACKBOARD", "Blackboard shutdown");
+    log_message("BLACKBOARD", "Blackboard shutdown in %.1fms", (now_us() - shutdown_us) / 1000.0);
 
     return 0;
 
@@ -1220,27 +1838,22 @@ int main(int argc, char *argv[])
 cleanup:
     log_message("BLACKBOARD", "Entering cleanup phase");
     
-    nanosleep(&ts, NULL); //delay for killing all processes (200ms)
-    
-    //check if processes killes
-    if (pid_input > 0) kill(pid_input, SIGKILL);
-    if (pid_drone > 0) kill(pid_drone, SIGKILL);
-    if(network==0){
-        if (pid_targets > 0) kill(pid_targets, SIGKILL);
-        if (pid_obstacles > 0) kill(pid_obstacles, SIGKILL);
-        if (pid_watchdog > 0) kill(pid_watchdog, SIGKILL);
-    }
-    
-    //avoid zombie child
-    wait_pid(pid_input, "INPUT");
-    wait_pid(pid_drone, "DRONE");
-    if(network==0){
-        wait_pid(pid_targets, "TARGETS");
-        wait_pid(pid_obstacles, "OBSTACLES");
-        wait_pid(pid_watchdog, "WATCHDOG");
-    }
+#ifdef THREADED_RUNTIME
+    runtime_join(); //worker threads started before the error
+#endif
+    //stop the children already started (same deadline, SIGKILL after it), no zombie child
+    ChildProc started[] = {
+        {network == 0 ? pid_watchdog : 0, "WATCHDOG"},
+        {pid_input, "INPUT"},
+        {pid_drone, "DRONE"},
+        {pid_renderer, "RENDERER"},
+        {network == 0 ? pid_targets : 0, "TARGETS"},
+        {network == 0 ? pid_obstacles : 0, "OBSTACLES"},
+    };
+    shutdown_children(started, sizeof(started) / sizeof(started[0]), SIGTERM, SHUTDOWN_DEADLINE_ms);
 
     //close all pipes
+    close_rings(&ch_input, &ch_drone, &ch_targets, &ch_obstacles);
     close(pipe_input[0]);
     close(pipe_input[1]);
     close(pipe_drone[0]);
@@ -1253,14 +1866,24 @@ cleanup:
     }  
     
     //cleanup shm
-    if (network == 0 && hb != MAP_FAILED && hb != NULL) { //if cleaunp before mmap
-        sem_destroy(&hb->mutex);
+    if (hb != NULL) { //if cleaunp before mmap
+        sem_destroy(&hb->ready);
         munmap(hb, sizeof(*hb));
     }
-    if (network == 0 && hb_fd >= 0) { //if cleaunp before hb
+    if (hb_fd >= 0) { //if cleaunp before hb
         close(hb_fd);
         shm_unlink(HB_SHM_NAME);
     }
+    if (state) munmap(state, sizeof(*state)); //if cleanup after the state shm
+    if (st_fd >= 0) { //also when its size or its mapping failed
+        close(st_fd);
+        shm_unlink(STATE_SHM_NAME);
+    }
+    if (dshm) { //if cleanup after the drone shm
+        munmap(dshm, sizeof(*dshm));
+        shm_unlink(DRONE_SHM_NAME);
+    }
+    if (cshm) config_shm_close(cshm, 1); //if cleanup after the config shm
 
     log_message("BLACKBOARD", "Blackboard shutdown");
     
@@ -0,0 +1,216 @@
+/* this file contains the function for the camera process
+    - follow the drone with the selected zoom level
+    - build the spatial index of the obstacles when they change
+    - draw the visible obstacles (one glyph for every screen cell at the coarse zoom levels)
+*/
+
+#include "camera.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define MAX_GRID_CELLS (1 << 20) //bigger worlds use bigger buckets
+
+//clamp an integer in [lo, hi]
+static inline int clampi(int v, int lo, int hi){
+    if (v < lo) return lo;
+    if (v > hi) return hi;
+    return v;
+}
+
+//bucket of the i-th obstacle (positions outside the world are clamped)
+static inline int bucket_of(const Camera *c, const Obstacle *o){
+    int bx = clampi(o->x, 0, c->world_w - 1) / c->bucket;
+    int by = clampi(o->y, 0, c->world_h - 1) / c->bucket;
+    return by * c->grid_w + bx;
+}
+
+//number of obstacles in the buckets [bx0, bx1] x [by0, by1] (summed area table)
+static inline int sat_sum(const Camera *c, int bx0, int by0, int bx1, int by1){
+    int w = c->grid_w + 1;
+    return c->sat[(by1 + 1) * w + (bx1 + 1)] - c->sat[by0 * w + (bx1 + 1)]
+         - c->sat[(by1 + 1) * w + bx0] + c->sat[by0 * w + bx0];
+}
+
+//rebuild the spatial index: counting sort of the obstacles by bucket + summed area table
+//(allocation failed: no index, valid = 0, the obstacles are not drawn and the next update tries again)
+static void rebuild_index(Camera *c, const GameState *g){
+    int W = (g->world_width  > 0) ? g->world_width  : 1;
+    int H = (g->world_height > 0) ? g->world_height : 1;
+
+    int b = 1; //bucket side
+    while ((long)((W + b - 1) / b) * ((H + b - 1) / b) > MAX_GRID_CELLS) b *= 2;
+
+    int gw = (W + b - 1) / b;
+    int gh = (H + b - 1) / b;
+    if (!c->valid || gw != c->grid_w || gh != c->grid_h) { //new world size
+        int *start = malloc(sizeof(int) * (gw * gh + 1));
+        int *sat = malloc(sizeof(int) * (gw + 1) * (gh + 1));
+        if (!start || !sat) {
+            free(start);
+            free(sat);
+            c->valid = 0;
+            return;
+        }
+        free(c->start);
+        free(c->sat);
+        c->start = start;
+        c->sat = sat;
+    }
+    if (c->index_cap < g->num_obstacles) {
+        int *index = malloc(sizeof(int) * g->num_obstacles);
+        if (!index) {
+            c->valid = 0;
+            return;
+        }
+        free(c->index);
+        c->index = index;
+        c->index_cap = g->num_obstacles;
+    }
+
+    c->bucket = b;
+    c->grid_w = gw;
+    c->grid_h = gh;
+    c->world_w = W;
+    c->world_h = H;
+
+    //count the obstacles of every bucket
+    int cells = gw * gh;
+    memset(c->start, 0, sizeof(int) * (cells + 1));
+    for (int i = 0; i < g->num_obstacles; i++) {
+        c->start[bucket_of(c, &g->obstacles[i]) + 1]++;
+    }
+    for (int k = 0; k < cells; k++) { //offsets
+        c->start[k + 1] += c->start[k];
+    }
+
+    //place the obstacles (start[k] moves to the end of the bucket k, then shift back)
+    for (int i = 0; i < g->num_obstacles; i++) {
+        c->index[c->start[bucket_of(c, &g->obstacles[i])]++] = i;
+    }
+    memmove(c->start + 1, c->start, sizeof(int) * cells);
+    c->start[0] = 0;
+
+    //summed area table of the counts
+    int w = gw + 1;
+    memset(c->sat, 0, sizeof(int) * w);
+    for (int by = 0; by < gh; by++) {
+        c->sat[(by + 1) * w] = 0;
+        for (int bx = 0; bx < gw; bx++) {
+            int k = by * gw + bx;
+            int count = c->start[k + 1] - c->start[k];
+            c->sat[(by + 1) * w + bx + 1] = count + c->sat[by * w + bx + 1]
+                                          + c->sat[(by + 1) * w + bx] - c->sat[by * w + bx];
+        }
+    }
+
+    c->rev = g->obstacles_rev;
+    c->valid = 1;
+}
+
+//start of the visible part along one axis: centered on the drone, inside the world when possible
+static double follow(double pos, double extent, int world){
+    if (extent >= world) return (world - extent) / 2.0; //the world is smaller than the view
+    double v = pos - extent / 2.0;
+    if (v < 0) v = 0;
+    if (v > world - extent) v = world - extent;
+    return v;
+}
+
+//update the viewport (and the index if the obstacles changed)
+void camera_update(Camera *c, const GameState *g, int view_w, int view_h){
+    if (view_w <= 0 || view_h <= 0) return; //no room inside the border (tiny terminal)
+
+    int W = (g->world_width  > 0) ? g->world_width  : 1;
+    int H = (g->world_height > 0) ? g->world_height : 1;
+
+    if (!c->valid || c->rev != g->obstacles_rev || c->world_w != W || c->world_h != H) {
+        rebuild_index(c, g);
+    }
+
+    int zoom = clampi(g->zoom, 0, ZOOM_LEVELS - 1);
+    if (zoom == 0) { //whole world in the window
+        c->scale_x = (double)W / view_w;
+        c->scale_y = (double)H / view_h;
+        c->x0 = 0;
+        c->y0 = 0;
+    } else { //follow the drone
+        double s = (double)(1 << (zoom - 1));
+        c->scale_x = s;
+        c->scale_y = s;
+        c->x0 = follow(g->drone.x, view_w * s, W);
+        c->y0 = follow(g->drone.y, view_h * s, H);
+    }
+}
+
+//screen cell of a world position (it can be outside the view)
+void camera_project(const Camera *c, double x, double y, int *col, int *row){
+    *col = (int)floor((x - c->x0) / c->scale_x);
+    *row = (int)floor((y - c->y0) / c->scale_y);
+}
+
+//glyph for the number of obstacles in a screen cell
+static chtype density_glyph(int count){
+    if (count == 1) return 'O';
+    if (count <= 9) return '0' + count;
+    return '#';
+}
+
+//draw the visible obstacles inside the window border
+void camera_draw_obstacles(const Camera *c, const GameState *g, WINDOW *win, int view_w, int view_h){
+    if (!c->valid || view_w <= 0 || view_h <= 0) return; //no index or no room inside the border
+    int B = c->bucket;
+
+    wattron(win, COLOR_PAIR(2));
+    if (c->scale_x >= B && c->scale_y >= B) { //coarse: every screen cell counts the buckets that start inside it
+        int bx_lo[view_w], bx_hi[view_w];
+        for (int col = 0; col < view_w; col++) {
+            bx_lo[col] = (int)ceil((c->x0 + col * c->scale_x) / B);
+            bx_hi[col] = (int)ceil((c->x0 + (col + 1) * c->scale_x) / B) - 1;
+            if (bx_lo[col] < 0) bx_lo[col] = 0;
+            if (bx_hi[col] > c->grid_w - 1) bx_hi[col] = c->grid_w - 1;
+        }
+
+        for (int row = 0; row < view_h; row++) {
+            int by_lo = (int)ceil((c->y0 + row * c->scale_y) / B);
+            int by_hi = (int)ceil((c->y0 + (row + 1) * c->scale_y) / B) - 1;
+            if (by_lo < 0) by_lo = 0;
+            if (by_hi > c->grid_h - 1) by_hi = c->grid_h - 1;
+            if (by_lo > by_hi) continue;
+
+            for (int col = 0; col < view_w; col++) {
+                if (bx_lo[col] > bx_hi[col]) continue;
+                int count = sat_sum(c, bx_lo[col], by_lo, bx_hi[col], by_hi);
+                if (count > 0) mvwaddch(win, 1 + row, 1 + col, density_glyph(count));
+            }
+        }
+    } else { //fine: only the obstacles of the visible buckets
+        int bx0 = clampi((int)floor(c->x0 / B), 0, c->grid_w - 1);
+        int by0 = clampi((int)floor(c->y0 / B), 0, c->grid_h - 1);
+        int bx1 = clampi((int)floor((c->x0 + view_w * c->scale_x) / B), 0, c->grid_w - 1);
+        int by1 = clampi((int)floor((c->y0 + view_h * c->scale_y) / B), 0, c->grid_h - 1);
+
+        for (int by = by0; by <= by1; by++) {
+            for (int bx = bx0; bx <= bx1; bx++) {
+                int k = by * c->grid_w + bx;
+                for (int j = c->start[k]; j < c->start[k + 1]; j++) {
+                    const Obstacle *o = &g->obstacles[c->index[j]];
+                    int col, row;
+                    camera_project(c, o->x, o->y, &col, &row);
+                    if (col < 0 || col >= view_w || row < 0 || row >= view_h) continue;
+                    mvwaddch(win, 1 + row, 1 + col, 'O');
+                }
+            }
+        }
+    }
+    wattroff(win, COLOR_PAIR(2));
+}
+
+//free the spatial index
+void camera_free(Camera *c){
+    free(c->start);
+    free(c->index);
+    free(c->sat);
+    memset(c, 0, sizeof(*c));
+}
@@ -0,0 +1,182 @@
+/* this file contains the configuration of all the processes (config.h)
+    - parser of parameters.config: one table of the keys instead of a strcmp chain in every process
+    - shared memory /config with the last Config published by the blackboard
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stddef.h>
+#include <sched.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "config.h"
+
+typedef enum {
+    KEY_INT,
+    KEY_DOUBLE,
+    KEY_RING, //TRANSPORT=ring|pipe
+    KEY_DRONE, //PHYSICS_OWNER=drone|blackboard
+    KEY_RELOC //RELOC_PERIOD_ms: targets and obstacles
+} KeyType;
+
+typedef struct {
+    const char *key;
+    KeyType type;
+    size_t offset;
+} ConfigKey;
+
+#define INT_KEY(k, field) {k, KEY_INT, offsetof(Config, field)}
+#define DOUBLE_KEY(k, field) {k, KEY_DOUBLE, offsetof(Config, field)}
+
+static const ConfigKey keys[] = {
+    //size
+    INT_KEY("WORLD_WIDTH", world_width),
+    INT_KEY("WORLD_HEIGHT", world_height),
+
+    //physics
+    DOUBLE_KEY("MASS", mass),
+    DOUBLE_KEY("K", k),
+    DOUBLE_KEY("DT", dt),
+    DOUBLE_KEY("COMMAND_FORCE", command_force),
+    DOUBLE_KEY("MAX_FORCE", max_force),
+    DOUBLE_KEY("RHO", rho),
+    DOUBLE_KEY("ETA", eta),
+    DOUBLE_KEY("ZETA", zeta),
+    DOUBLE_KEY("TANGENT_GAIN", tangent_gain),
+
+    //drone
+    INT_KEY("DRONE_START_X", drone_start_x),
+    INT_KEY("DRONE_START_Y", drone_start_y),
+
+    //targets and obstacles
+    INT_KEY("NUM_TARGETS", num_targets),
+    INT_KEY("NUM_OBSTACLES", num_obstacles),
+    {"RELOC_PERIOD_ms", KEY_RELOC, 0},
+
+    //network
+    INT_KEY("ROTATION", rotation),
+
+    //renderer process and inspection panels
+    INT_KEY("RENDER_FPS", render_fps),
+    INT_KEY("PANEL_REFRESH_ms", panel_refresh_ms),
+
+    //worker messages and drone dynamics
+    {"TRANSPORT", KEY_RING, offsetof(Config, transport_ring)},
+    {"PHYSICS_OWNER", KEY_DRONE, offsetof(Config, physics_drone)},
+
+    //scheduling profile of the tick path
+    INT_KEY("CPU_BLACKBOARD", cpu_blackboard),
+    INT_KEY("CPU_DRONE", cpu_drone),
+    INT_KEY("CPU_WATCHDOG", cpu_watchdog),
+    INT_KEY("RT_PRIORITY", rt_priority),
+    INT_KEY("MLOCKALL", mlock),
+
+    //supervisor
+    INT_KEY("RESTART_WORKERS", restart_workers),
+};
+
+//remove the spaces at the end of the key ("ROTATION = 0")
+static void trim_right(char *s){
+    size_t n = strlen(s);
+    while (n > 0 && isspace((unsigned char)s[n - 1])) s[--n] = '\0';
+}
+
+static void set_key(Config *cfg, const char *key, const char *value){
+    for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); i++) {
+        if (strcmp(keys[i].key, key) != 0) continue;
+
+        char *field = (char *)cfg + keys[i].offset;
+        switch (keys[i].type) {
+            case KEY_INT: *(int *)field = atoi(value); break;
+            case KEY_DOUBLE: *(double *)field = atof(value); break;
+            case KEY_RING: *(int *)field = !strcmp(value, "ring"); break;
+            case KEY_DRONE: *(int *)field = !strcmp(value, "drone"); break;
+            case KEY_RELOC: cfg->target_reloc = cfg->obstacle_reloc = atoi(value); break;
+        }
+        return;
+    }
+}
+
+int config_load(const char *path, Config *cfg){
+    memset(cfg, 0, sizeof(Config));
+    cfg->panel_refresh_ms = 100; //default: the panels do not need the map rate
+    cfg->transport_ring = 1; //default: shared memory rings (pipes as fallback)
+    cfg->cpu_blackboard = cfg->cpu_drone = cfg->cpu_watchdog = -1; //default: not pinned
+    cfg->restart_workers = 3; //default: a failed worker is restarted alone
+
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        char key[128], value[128];
+        if (line[0] == '#') continue;
+        if (sscanf(line, " %127[^=]= %127s", key, value) == 2) {
+            trim_right(key);
+            set_key(cfg, key, value);
+        }
+    }
+    fclose(f);
+    return 0;
+}
+
+int config_valid(const Config *cfg){
+    return cfg->world_width > 0 && cfg->world_height > 0 && cfg->mass > 0 && cfg->dt > 0;
+}
+
+ConfigShm *config_shm_create(void){
+    int fd = shm_open(CONFIG_SHM_NAME, O_CREAT | O_RDWR, 0666);
+    if (fd < 0) return NULL;
+    if (ftruncate(fd, sizeof(ConfigShm)) < 0) {
+        close(fd);
+        return NULL;
+    }
+    ConfigShm *shm = mmap(NULL, sizeof(ConfigShm), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (shm == MAP_FAILED) return NULL;
+    memset(shm, 0, sizeof(*shm));
+    return shm;
+}
+
+void config_publish(ConfigShm *shm, const Config *cfg){
+    uint32_t seq = atomic_load_explicit(&shm->seq, memory_order_relaxed);
+    atomic_store_explicit(&shm->seq, seq + 1, memory_order_relaxed); //odd -> readers retry
+    atomic_thread_fence(memory_order_release);
+    shm->cfg = *cfg;
+    atomic_store_explicit(&shm->seq, seq + 2, memory_order_release); //even -> consistent
+    atomic_fetch_add_explicit(&shm->version, 1, memory_order_release); //after the copy: a new version is complete
+}
+
+const ConfigShm *config_shm_open(void){
+    int fd = shm_open(CONFIG_SHM_NAME, O_RDONLY, 0666);
+    if (fd < 0) return NULL;
+    const ConfigShm *shm = mmap(NULL, sizeof(ConfigShm), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    return shm == MAP_FAILED ? NULL : shm;
+}
+
+uint32_t config_read(const ConfigShm *shm, Config *out){
+    for (int attempt = 0; ; attempt++) {
+        uint32_t version = atomic_load_explicit(&shm->version, memory_order_acquire);
+        uint32_t s1 = atomic_load_explicit(&shm->seq, memory_order_acquire);
+        if (s1 & 1) { //publication in progress
+            if (attempt > 100) sched_yield();
+            continue;
+        }
+        memcpy(out, &shm->cfg, sizeof(*out));
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&shm->seq, memory_order_relaxed) == s1) return version;
+    }
+}
+
+void config_shm_close(const ConfigShm *shm, int unlink_it){
+    if (shm) munmap((void *)shm, sizeof(ConfigShm));
+    if (unlink_it) shm_unlink(CONFIG_SHM_NAME);
+}
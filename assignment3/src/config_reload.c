@@ -0,0 +1,138 @@
+/* this file contains the hot reload of the config (config_reload.h)
+    - inotify watch on the directory of parameters.config
+    - reload thread: waits a request, parses the file, writes the eventfd
+    - the event loop only copies the parsed Config
+*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+
+#include "config_reload.h"
+#include "perf.h"
+#include "logger.h"
+
+static void *reload_thread(void *arg){
+    ConfigReload *r = arg;
+    static Config tmp; //parsed outside the lock
+
+    pthread_mutex_lock(&r->lock);
+    while (!r->stop) {
+        if (!r->requested) {
+            pthread_cond_wait(&r->wake, &r->lock);
+            continue;
+        }
+        r->requested = 0;
+        pthread_mutex_unlock(&r->lock);
+
+        uint64_t t0 = now_us();
+        r->parse(r->path, &tmp);
+        uint64_t t1 = now_us();
+
+        pthread_mutex_lock(&r->lock);
+        r->parsed = tmp;
+        r->parse_us = t1 - t0;
+        pthread_mutex_unlock(&r->lock);
+
+        uint64_t one = 1;
+        if (write(r->ready_fd, &one, sizeof(one)) < 0) perror("reload eventfd");
+        pthread_mutex_lock(&r->lock);
+    }
+    pthread_mutex_unlock(&r->lock);
+    return NULL;
+}
+
+int reload_start(ConfigReload *r, const char *path, ConfigParser parse){
+    memset(r, 0, sizeof(*r));
+    r->path = path;
+    r->parse = parse;
+    r->watch_fd = -1;
+
+    const char *slash = strrchr(path, '/');
+    r->file = slash ? slash + 1 : path;
+
+    r->ready_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (r->ready_fd < 0) return -1;
+
+    //the directory, not the file: an editor that saves by rename replaces the inode of the file
+    char dir[PATH_MAX];
+    if (slash) snprintf(dir, sizeof(dir), "%.*s", (int)(slash - path), path);
+    else snprintf(dir, sizeof(dir), ".");
+    r->watch_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (r->watch_fd >= 0 && inotify_add_watch(r->watch_fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        log_message("BLACKBOARD", "WARNING: cannot watch %s (%s), reload only with 'P' or SIGUSR2", dir, strerror(errno));
+        close(r->watch_fd);
+        r->watch_fd = -1;
+    }
+
+    pthread_mutex_init(&r->lock, NULL);
+    pthread_cond_init(&r->wake, NULL);
+    if (pthread_create(&r->tid, NULL, reload_thread, r) != 0) {
+        if (r->watch_fd >= 0) close(r->watch_fd);
+        close(r->ready_fd);
+        r->watch_fd = r->ready_fd = -1;
+        return -1;
+    }
+    r->started = 1;
+    return 0;
+}
+
+void reload_request(ConfigReload *r, const char *why){
+    if (!r->started) return;
+    pthread_mutex_lock(&r->lock);
+    if (!r->requested) r->request_us = now_us(); //merged with a request not parsed yet
+    r->requested = 1;
+    pthread_cond_signal(&r->wake);
+    pthread_mutex_unlock(&r->lock);
+    log_message("BLACKBOARD", "[RELOAD] requested (%s)", why);
+}
+
+int reload_watch(ConfigReload *r){
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    int changed = 0;
+    ssize_t n;
+
+    while ((n = read(r->watch_fd, buf, sizeof(buf))) > 0) {
+        for (char *p = buf; p < buf + n; ) {
+            const struct inotify_event *ev = (const struct inotify_event *)p;
+            if (ev->len > 0 && strcmp(ev->name, r->file) == 0) changed = 1;
+            p += sizeof(*ev) + ev->len;
+        }
+    }
+    if (changed) reload_request(r, "file changed");
+    return changed;
+}
+
+int reload_take(ConfigReload *r, Config *out, uint64_t *request_us, uint64_t *parse_us){
+    uint64_t cnt;
+    if (read(r->ready_fd, &cnt, sizeof(cnt)) != sizeof(cnt)) return 0;
+
+    pthread_mutex_lock(&r->lock);
+    *out = r->parsed;
+    *request_us = r->request_us;
+    *parse_us = r->parse_us;
+    pthread_mutex_unlock(&r->lock);
+    return 1;
+}
+
+void reload_stop(ConfigReload *r){
+    if (!r->started) return;
+    pthread_mutex_lock(&r->lock);
+    r->stop = 1;
+    pthread_cond_signal(&r->wake);
+    pthread_mutex_unlock(&r->lock);
+    pthread_join(r->tid, NULL);
+
+    pthread_mutex_destroy(&r->lock);
+    pthread_cond_destroy(&r->wake);
+    if (r->watch_fd >= 0) close(r->watch_fd);
+    close(r->ready_fd);
+    r->started = 0;
+}
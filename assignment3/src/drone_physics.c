@@ -3,6 +3,7 @@
     - compute the repulsive force form the obstacles
     - compute the repulsive force from the fence
     - calculate the total force
+    - apply the commands merged since the last tick
 */
 
 #include <math.h>
@@ -40,6 +41,33 @@ void use_brake(GameState *gs){
     gs->drone.vy *= brake_factor;
 }
 
+// INPUT - commands of one tick
+void input_accumulate(InputAccum *a, char type, int mx, int my, uint64_t now){
+    if (type != 'I' && type != 'B') return;
+    if (a->commands == 0) a->first_us = now;
+    a->commands++;
+
+    if (type == 'B') a->brake = 1; //more brakes in the same tick are one brake
+    else {
+        a->mx += mx;
+        a->my += my;
+    }
+}
+
+int apply_input(GameState *gs, InputAccum *a){
+    int n = a->commands;
+    if (n == 0) return 0;
+
+    //same order at every tick: brake, then the new direction
+    if (a->brake) use_brake(gs);
+    if (a->mx != 0 || a->my != 0) add_direction(gs, a->mx, a->my);
+
+    a->mx = a->my = 0;
+    a->brake = 0;
+    a->commands = 0;
+    return n;
+}
+
 
 // OBSTACLES - repulsion (using Khatib's potential field)
 //radial: distance from obstacle
@@ -0,0 +1,129 @@
+/* this file contains the heartbeat monitor (make hbmon)
+    - maps read-only the heartbeat table of the game (heartbeat shm)
+    - prints one table every period: one row for each active slot with pid, age of the heartbeat, iterations of the
+      main loop (total and per second), last and longest iteration and the bytes waiting in its channel
+    - never writes in the shm and never waits the processes (relaxed loads of hb_loop), any number can run
+    - not a process of the game: no heartbeat slot, no log
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "heartbeat.h"
+
+static volatile sig_atomic_t g_stop = 0; //Ctrl+C
+
+static void on_signal(int sig) {
+    (void)sig;
+    g_stop = 1;
+}
+
+//one table with the rates since the previous one (prev_iter: iterations of every slot at the previous table)
+static int print_table(const HeartbeatTable *hb, uint64_t prev_iter[HB_MAX_SLOTS], pid_t prev_pid[HB_MAX_SLOTS],
+                       uint64_t elapsed_ms, int clear) {
+    if (clear) printf("\033[H\033[2J"); //terminal: the table stays in place
+    printf("%-4s %-20s %8s %9s %12s %9s %10s %10s %8s\n",
+           "slot", "name", "pid", "age(ms)", "iterations", "it/s", "loop(us)", "max(us)", "queue");
+
+    int active = 0;
+    int used = hb_used(hb);
+    for (int i = 0; i < used; i++) {
+        if (!hb_active(hb, i)) {
+            prev_pid[i] = 0;
+            continue;
+        }
+        const HbEntry *e = &hb->entries[i];
+        pid_t pid = hb_pid(hb, i);
+        uint64_t iter = atomic_load_explicit(&e->iterations, memory_order_relaxed);
+        uint64_t seen = hb_last_seen(hb, i);
+        uint64_t now = now_ms();
+
+        //rate only for the same process (a restarted worker starts again from 0)
+        double rate = (prev_pid[i] == pid && elapsed_ms > 0 && iter >= prev_iter[i])
+                          ? (iter - prev_iter[i]) * 1000.0 / elapsed_ms : 0.0;
+        prev_iter[i] = iter;
+        prev_pid[i] = pid;
+
+        char name[HB_NAME_LEN + 1];
+        memcpy(name, e->name, HB_NAME_LEN);
+        name[HB_NAME_LEN] = '\0';
+
+        printf("%-4d %-20s %8d %9llu %12llu %9.1f %10u %10u %8u\n",
+               i, name, (int)pid, (unsigned long long)(now > seen ? now - seen : 0), (unsigned long long)iter, rate,
+               atomic_load_explicit(&e->loop_us, memory_order_relaxed),
+               atomic_load_explicit(&e->loop_max_us, memory_order_relaxed),
+               atomic_load_explicit(&e->queue, memory_order_relaxed));
+        active++;
+    }
+    printf("\n");
+    fflush(stdout);
+    return active;
+}
+
+
+int main(int argc, char *argv[])
+{
+    /*optional args:
+        1. period in ms (default 1000)
+        2. number of tables (default 0: until Ctrl+C or the end of the game)
+    */
+    if (argc > 1 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0)) {
+        printf("Usage: %s [period_ms] [count]\n", argv[0]);
+        return 0;
+    }
+    int period_ms = (argc > 1) ? atoi(argv[1]) : 1000;
+    int count = (argc > 2) ? atoi(argv[2]) : 0;
+    if (period_ms <= 0) period_ms = 1000;
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    //map the heartbeat table (read-only)
+    int hb_fd = shm_open(HB_SHM_NAME, O_RDONLY, 0666);
+    if (hb_fd < 0) {
+        fprintf(stderr, "hb_monitor: %s not found (is the blackboard running?)\n", HB_SHM_NAME);
+        return 1;
+    }
+    const HeartbeatTable *hb = mmap(NULL, sizeof(HeartbeatTable), PROT_READ, MAP_SHARED, hb_fd, 0);
+    close(hb_fd);
+    if (hb == MAP_FAILED) {
+        perror("hb_monitor mmap");
+        return 1;
+    }
+    if (!hb_layout_ok(hb, "hb_monitor")) {
+        munmap((void *)hb, sizeof(HeartbeatTable));
+        return 1;
+    }
+
+    uint64_t prev_iter[HB_MAX_SLOTS] = {0};
+    pid_t prev_pid[HB_MAX_SLOTS] = {0};
+    uint64_t prev_ms = now_ms();
+    int clear = isatty(STDOUT_FILENO);
+
+    struct timespec ts = { period_ms / 1000, (long)(period_ms % 1000) * 1000000L };
+
+    for (int n = 0; !g_stop && (count == 0 || n < count); n++) {
+        uint64_t t = now_ms();
+        if (print_table(hb, prev_iter, prev_pid, t - prev_ms, clear) == 0) {
+            printf("no active process (blackboard stopped)\n");
+            break;
+        }
+        prev_ms = t;
+        nanosleep(&ts, NULL);
+    }
+
+    munmap((void *)hb, sizeof(HeartbeatTable));
+    return 0;
+}
@@ -0,0 +1,164 @@
+/* this file contains the benchmark of the heartbeat table (make bench)
+    - forked writers (one for each worker slot) write their heartbeat in a loop, the parent scans all the slots
+      like the watchdog
+    - locked: layout 1, one process-shared semaphore around every read and write, slots packed in the same lines
+    - atomic: slots of heartbeat.h (layout 2 and later), one atomic store for each heartbeat, one cache line for each slot
+    - cost of a heartbeat and of a scan of the table (mean, p99, max in ns) and heartbeats per second
+*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "heartbeat.h"
+#include "perf.h"
+
+#define SLOTS HB_PROCS //slots of the game
+#define WRITERS (SLOTS - 1) //all the slots but the blackboard (the parent scans)
+
+//layout 1 of the table (before the atomic slots)
+typedef struct {
+    uint64_t last_seen_ms;
+    pid_t pid;
+} LockedEntry;
+
+typedef struct {
+    sem_t mutex;
+    LockedEntry entries[SLOTS];
+} LockedTable;
+
+typedef struct {
+    PerfHist beat[WRITERS]; //ns of every heartbeat
+    uint64_t beats[WRITERS];
+    _Atomic int start, stop;
+} Results;
+
+static uint64_t now_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void beat(void *table, int locked, int slot){
+    if (locked) {
+        LockedTable *t = table;
+        sem_wait(&t->mutex);
+        t->entries[slot].last_seen_ms = now_ms();
+        sem_post(&t->mutex);
+    } else {
+        hb_beat(table, slot);
+    }
+}
+
+//same reads of the watchdog loop: pid and timestamp of every slot
+static uint64_t scan(void *table, int locked){
+    uint64_t sum = 0;
+    for (int i = 0; i < SLOTS; i++) {
+        if (locked) {
+            LockedTable *t = table;
+            sem_wait(&t->mutex);
+            sum += (uint64_t)t->entries[i].pid + t->entries[i].last_seen_ms;
+            sem_post(&t->mutex);
+        } else {
+            sum += (uint64_t)hb_pid(table, i) + hb_last_seen(table, i);
+        }
+    }
+    return sum;
+}
+
+static void writer(void *table, int locked, int slot, Results *r, int idx){
+    while (!atomic_load(&r->start)) sched_yield();
+    PerfHist h;
+    perf_reset(&h);
+    uint64_t n = 0;
+    while (!atomic_load(&r->stop)) {
+        uint64_t t0 = now_ns();
+        beat(table, locked, slot);
+        perf_record(&h, now_ns() - t0);
+        n++;
+    }
+    r->beat[idx] = h;
+    r->beats[idx] = n;
+}
+
+static void run(int locked, int duration_ms){
+    size_t size = locked ? sizeof(LockedTable) : sizeof(HeartbeatTable);
+    void *table = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    Results *r = mmap(NULL, sizeof(Results), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (table == MAP_FAILED || r == MAP_FAILED) {
+        perror("mmap");
+        exit(1);
+    }
+    memset(r, 0, sizeof(*r));
+    if (locked) sem_init(&((LockedTable *)table)->mutex, 1, 1);
+    else hb_init(table);
+
+    pid_t pids[WRITERS];
+    for (int w = 0; w < WRITERS; w++) {
+        pids[w] = fork();
+        if (pids[w] == 0) {
+            writer(table, locked, w + 1, r, w);
+            _exit(0);
+        }
+    }
+
+    PerfHist scans;
+    perf_reset(&scans);
+    volatile uint64_t sink = 0;
+    atomic_store(&r->start, 1);
+    uint64_t end = now_ns() + (uint64_t)duration_ms * 1000000ULL;
+    while (now_ns() < end) {
+        uint64_t t0 = now_ns();
+        sink += scan(table, locked);
+        perf_record(&scans, now_ns() - t0);
+    }
+    atomic_store(&r->stop, 1);
+    for (int w = 0; w < WRITERS; w++) waitpid(pids[w], NULL, 0);
+    (void)sink;
+
+    PerfHist all;
+    perf_reset(&all);
+    uint64_t beats = 0;
+    for (int w = 0; w < WRITERS; w++) {
+        beats += r->beats[w];
+        for (int b = 0; b < PERF_BUCKETS; b++) all.buckets[b] += r->beat[w].buckets[b];
+        all.count += r->beat[w].count;
+        all.sum += r->beat[w].sum;
+        if (r->beat[w].max > all.max) all.max = r->beat[w].max;
+    }
+
+    printf("%-6s beats/s=%-10.0f beat: mean=%lluns p99<=%lluns max=%lluns | scan: n=%-8llu mean=%lluns p99<=%lluns max=%lluns\n",
+           locked ? "locked" : "atomic", beats * 1000.0 / duration_ms,
+           (unsigned long long)(all.count ? all.sum / all.count : 0), (unsigned long long)perf_percentile(&all, 99),
+           (unsigned long long)all.max, (unsigned long long)scans.count,
+           (unsigned long long)(scans.count ? scans.sum / scans.count : 0), (unsigned long long)perf_percentile(&scans, 99),
+           (unsigned long long)scans.max);
+
+    if (locked) sem_destroy(&((LockedTable *)table)->mutex);
+    munmap(table, size);
+    munmap(r, sizeof(*r));
+}
+
+
+int main(int argc, char *argv[])
+{
+    /*optional args:
+        1. duration of each run in ms (default 2000)
+    */
+    int duration = (argc > 1) ? atoi(argv[1]) : 2000;
+    if (duration <= 0) duration = 2000;
+
+    printf("heartbeat table: %d writers, 1 reader, %d ms for each layout, %zu bytes (layout %d)\n",
+           WRITERS, duration, sizeof(HeartbeatTable), HB_LAYOUT_VERSION);
+    run(1, duration);
+    run(0, duration);
+    return 0;
+}
@@ -3,6 +3,7 @@
 */
 
 #include "map.h"
+#include "camera.h"
 
 #include <string.h>
 #include <stdlib.h>
@@ -41,6 +42,7 @@ void init_screen(Screen*s, int netMode){
         s-> height = LINES-s -> starty-1;
         s-> width = COLS-2;
     }
+    memset(&s->cam, 0, sizeof(s->cam)); //camera index built at the first render
     
     s-> win = create_newwin(s->height, s->width, s->starty, s->startx);
 }
@@ -62,6 +64,7 @@ void refresh_screen(Screen *s, int netMode) {
     }
 
     destroy_win(s->win); //destroy the window
+    camera_free(&s->cam); //index built again at the next render with the new size
     s->win = create_newwin(s->height, s->width, s->starty, s->startx); //draw the window with the new dimensions
 
     clrtoeol();   
@@ -136,19 +139,28 @@ void render(Screen *s, GameState *g){
     werase(s->win); //dedine the border of the map
     box(s->win, 0, 0);
 
-    mvwprintw(s->win, 0, 2, "Score: %d | Targets: %d/%d", g->score, g->total_target_collected, g->total_targets); //print the score of the game
+    int view_w = s->width - 2; //inside the border
+    int view_h = s->height - 2;
+    if (view_w < 1 || view_h < 1) {
+        wrefresh(s->win);
+        return;
+    }
+
+    camera_update(&s->cam, g, view_w, view_h); //follow the drone
 
-    double sx = 1.0, sy = 1.0; //resize the map
-    if (g->world_width  > 1)
-        sx = (double)(s->width  - 2) / (g->world_width  - 1);
-    if (g->world_height > 1)
-        sy = (double)(s->height - 2) / (g->world_height - 1);
+    if (g->zoom > 0) { //print the score of the game
+        mvwprintw(s->win, 0, 2, "Score: %d | Targets: %d/%d | Zoom: x%d", g->score, g->total_target_collected, g->total_targets, 1 << (g->zoom - 1));
+    } else {
+        mvwprintw(s->win, 0, 2, "Score: %d | Targets: %d/%d", g->score, g->total_target_collected, g->total_targets);
+    }
 
-    // targets need to be inside the map 
+    // targets need to be inside the map (outside the view: on the border, toward the target)
     if (g->num_targets > 0 && g->current_target_index < g->num_targets) {
         int i = g->current_target_index;
-        int tx = 1 + (int)round(g->targets[i].x * sx);
-        int ty = 1 + (int)round(g->targets[i].y * sy);
+        int tx, ty;
+        camera_project(&s->cam, g->targets[i].x, g->targets[i].y, &tx, &ty);
+        tx = 1 + tx;
+        ty = 1 + ty;
         if (tx < 1) tx = 1;
         if (tx > s->width-2) tx = s->width-2;
         if (ty < 1) ty = 1;
@@ -160,25 +172,14 @@ void render(Screen *s, GameState *g){
         wattroff(s->win, COLOR_PAIR(1));
     }
 
-    // obstacles need to be inside the map 
-    for (int i = 0; i < g->num_obstacles; i++) {
-        int ox = 1 + (int)round(g->obstacles[i].x * sx);
-        int oy = 1 + (int)round(g->obstacles[i].y * sy);
-        if (ox < 1) ox = 1;
-        if (ox > s->width-2) ox = s->width-2;
-        if (oy < 1) oy = 1;
-        if (oy > s->height-2) oy = s->height-2;
-
-        //design of the obstacle
-        wattron(s->win, COLOR_PAIR(2));
-        mvwaddch(s->win, oy, ox, 'O');
-        wattroff(s->win, COLOR_PAIR(2));
-        
-    }
+    // obstacles in the view (spatial query, density glyphs at the coarse zoom levels)
+    camera_draw_obstacles(&s->cam, g, s->win, view_w, view_h);
 
     // drone need to be inside the map 
-    int dx = 1 + (int)round(g->drone.x * sx);
-    int dy = 1 + (int)round(g->drone.y * sy);
+    int dx, dy;
+    camera_project(&s->cam, g->drone.x, g->drone.y, &dx, &dy);
+    dx = 1 + dx;
+    dy = 1 + dy;
     if (dx < 1) dx = 1;
     if (dx > s->width-2) dx = s->width-2;
     if (dy < 1) dy = 1;
@@ -190,4 +191,4 @@ void render(Screen *s, GameState *g){
     wattroff(s->win, COLOR_PAIR(3) | A_BOLD);
 
     wrefresh(s->win); 
-}
\ No newline at end of file
+}
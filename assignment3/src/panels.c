@@ -0,0 +1,232 @@
+/* this file contains the function for the inspection panels
+    - create the info, processes, collision and help windows (help is printed once)
+    - print the values of the gamestate in the windows only when they change
+    - performance overlay, printed again only when a new summary is ready (once per second)
+    - print the game mode and the final statistics
+*/
+
+#include "panels.h"
+#include "logger.h"
+
+#include <string.h>
+
+//create the inspection windows
+void init_panels(Panels *p, int refresh_ms){
+    memset(p, 0, sizeof(*p));
+    p->refresh_ms = refresh_ms;
+
+    p->info_win = newwin(8, 40, 0, 2); //info window
+    box(p->info_win, 0, 0);
+    mvwprintw(p->info_win, 0, 2, "[ Info ]");
+
+    p->processes_win = newwin(6, 40, 0, 60); //processes pid window
+    box(p->processes_win, 0, 0);
+    mvwprintw(p->processes_win, 0, 2, "[ Processes ]");
+
+    p->collision_win = newwin(5, 40, 8, 2); //collision window
+    box(p->collision_win, 0, 0);
+    mvwprintw(p->collision_win, 0, 2, "[ Collisions ]");
+
+    p->help_win = newwin(5, 40, 8, 60); //help window: it never changes
+    box(p->help_win, 0, 0);
+    mvwprintw(p->help_win, 0, 2, "[ Help ]");
+    mvwprintw(p->help_win, 1,2, "Run 'make help' in the terminal");
+    mvwprintw(p->help_win, 2,2, "to see all available commands."); 
+    wrefresh(p->help_win);
+}
+
+//print a line only if its values changed (return 1 if the window has to be refreshed)
+static int update_field(Panels *p, int id, WINDOW *win, int row, double a, double b, const char *fmt){
+    PanelField *f = &p->fields[id];
+    if (f->valid && f->a == a && f->b == b) {
+        p->unchanged++;
+        return 0;
+    }
+    f->a = a;
+    f->b = b;
+    f->valid = 1;
+    p->formatted++;
+
+    char line[64];
+    snprintf(line, sizeof(line), fmt, a, b);
+    mvwprintw(win, row, 2, "%-*s", getmaxx(win) - 3, line); //pad: clear the old text, not the border
+    return 1;
+}
+
+//same for the integer values
+static int update_field_int(Panels *p, int id, WINDOW *win, int row, int a, int b, const char *fmt){
+    PanelField *f = &p->fields[id];
+    if (f->valid && f->a == a && f->b == b) {
+        p->unchanged++;
+        return 0;
+    }
+    f->a = a;
+    f->b = b;
+    f->valid = 1;
+    p->formatted++;
+
+    char line[64];
+    snprintf(line, sizeof(line), fmt, a, b);
+    mvwprintw(win, row, 2, "%-*s", getmaxx(win) - 3, line);
+    return 1;
+}
+
+//debug - print inspection windows (at most every refresh_ms)
+void draw_panels(Panels *p, const GameState *g, const pid_t pids[HB_PROCS]){
+    p->calls++;
+    uint64_t now = now_ms();
+    if (p->refresh_ms > 0 && now - p->last_refresh_ms < (uint64_t)p->refresh_ms) {
+        p->skipped++;
+        return;
+    }
+    p->last_refresh_ms = now;
+
+    int info = 0;
+    info |= update_field(p, FIELD_CMD, p->info_win, 1, g->fx_cmd, g->fy_cmd, "Cmd: fx=%.2f fy=%.2f");
+    info |= update_field(p, FIELD_OBST, p->info_win, 2, g->fx_obst, g->fy_obst, "Obst: fx=%.2f fy=%.2f");
+    info |= update_field(p, FIELD_FENCE, p->info_win, 3, g->fx_fence, g->fy_fence, "Fence: fx=%.2f fy=%.2f");
+    info |= update_field(p, FIELD_VEL, p->info_win, 4, g->drone.vx, g->drone.vy, "Vel: vx=%.2f vy=%.2f");
+    info |= update_field(p, FIELD_POS, p->info_win, 5, g->drone.x, g->drone.y, "Pos: x=%.2f y=%.2f");
+    info |= update_field_int(p, FIELD_TARGETS, p->info_win, 6, g->total_target_collected, g->total_targets, "Targets: %d/%d");
+
+    int processes = 0;
+    if (!p->perf_win) { //covered by the overlay
+        processes |= update_field_int(p, FIELD_PID_INPUT, p->processes_win, 1, pids[HB_PROC_INPUT], 0, "Input PID: %d");
+        processes |= update_field_int(p, FIELD_PID_DRONE, p->processes_win, 2, pids[HB_PROC_DRONE], 0, "Drone PID: %d");
+        processes |= update_field_int(p, FIELD_PID_TARGETS, p->processes_win, 3, pids[HB_PROC_TARGETS], 0, "Targets PID: %d");
+        processes |= update_field_int(p, FIELD_PID_OBSTACLES, p->processes_win, 4, pids[HB_PROC_OBSTACLES], 0, "Obstacles PID: %d");
+    }
+
+    int collision = 0;
+    collision |= update_field_int(p, FIELD_OBSTACLES_HIT, p->collision_win, 1, g->obstacles_hit_tot, 0, "Obstacles hit: %d");
+    collision |= update_field_int(p, FIELD_FENCE_HIT, p->collision_win, 2, g->fence_collision_tot, 0, "Fence hit: %d");
+    collision |= update_field_int(p, FIELD_SCORE, p->collision_win, 3, g->score, 0, "Score: %d");
+
+    //only the changed windows, one terminal update
+    if (info) { wnoutrefresh(p->info_win); p->refreshes++; }
+    if (processes) { wnoutrefresh(p->processes_win); p->refreshes++; }
+    if (collision) { wnoutrefresh(p->collision_win); p->refreshes++; }
+    if (info || processes || collision) doupdate();
+}
+
+//after a resize: draw again all the windows at the next call
+void invalidate_panels(Panels *p){
+    touchwin(p->info_win);
+    touchwin(p->processes_win);
+    touchwin(p->collision_win);
+    touchwin(p->help_win);
+    if (p->perf_win) { //the overlay stays on top
+        touchwin(p->perf_win);
+        wnoutrefresh(p->perf_win);
+    } else {
+        wnoutrefresh(p->help_win);
+    }
+    for (int i = 0; i < PANEL_FIELDS; i++) p->fields[i].valid = 0;
+    p->last_refresh_ms = 0;
+}
+
+//show or hide the performance overlay
+void set_overlay(Panels *p, int on){
+    if (on && !p->perf_win) {
+        p->perf_win = newwin(13, 40, 0, 60); //over the processes and help windows
+        p->perf_window = 0;
+        box(p->perf_win, 0, 0);
+        mvwprintw(p->perf_win, 0, 2, "[ Performance ]");
+        mvwprintw(p->perf_win, 1, 2, "waiting for the first second...");
+        wrefresh(p->perf_win);
+    } else if (!on && p->perf_win) {
+        werase(p->perf_win);
+        wnoutrefresh(p->perf_win);
+        delwin(p->perf_win);
+        p->perf_win = NULL;
+
+        //the covered windows come back
+        touchwin(p->processes_win);
+        touchwin(p->help_win);
+        for (int i = FIELD_PID_INPUT; i <= FIELD_PID_OBSTACLES; i++) p->fields[i].valid = 0;
+        wnoutrefresh(p->processes_win);
+        wnoutrefresh(p->help_win);
+        doupdate();
+    }
+}
+
+//print the summary of the last second (only when it is new)
+void draw_overlay(Panels *p, const PerfSummary *perf){
+    if (!p->perf_win || perf->window == 0 || perf->window == p->perf_window) return;
+    p->perf_window = perf->window;
+
+    WINDOW *w = p->perf_win;
+    werase(w);
+    box(w, 0, 0);
+    mvwprintw(w, 0, 2, "[ Performance ]");
+    mvwprintw(w, 1, 2, "Physics: %.1f ticks/s", perf->tick_hz);
+    mvwprintw(w, 2, 2, "Loop:   p50<=%lluus p99<=%lluus", (unsigned long long)perf->loop_p50_us, (unsigned long long)perf->loop_p99_us);
+    mvwprintw(w, 3, 2, "Render: p50<=%lluus p99<=%lluus", (unsigned long long)perf->render_p50_us, (unsigned long long)perf->render_p99_us);
+    mvwprintw(w, 4, 2, "Frames: %llu/s  Wake-ups: %llu/s", (unsigned long long)perf->frames, (unsigned long long)perf->wakeups_s);
+    mvwprintw(w, 5, 2, "Timers: p50<=%lluus p99<=%lluus", (unsigned long long)perf->dispatch_p50_us, (unsigned long long)perf->dispatch_p99_us);
+    mvwprintw(w, 6, 2, "Messages/s:");
+    mvwprintw(w, 7, 2, "  input %-6llu drone %llu", (unsigned long long)perf->pipe_msgs[PERF_PIPE_INPUT], (unsigned long long)perf->pipe_msgs[PERF_PIPE_DRONE]);
+    mvwprintw(w, 8, 2, "  targets %-4llu obstacles %llu", (unsigned long long)perf->pipe_msgs[PERF_PIPE_TARGETS], (unsigned long long)perf->pipe_msgs[PERF_PIPE_OBSTACLES]);
+    mvwprintw(w, 9, 2, "Batch max: %llu/%llu/%llu/%llu (in/dr/tg/ob)", (unsigned long long)perf->batch_max[PERF_PIPE_INPUT],
+              (unsigned long long)perf->batch_max[PERF_PIPE_DRONE], (unsigned long long)perf->batch_max[PERF_PIPE_TARGETS],
+              (unsigned long long)perf->batch_max[PERF_PIPE_OBSTACLES]);
+    mvwprintw(w, 10, 2, "Terminal: %llu B/s", (unsigned long long)perf->term_bytes_s);
+    mvwprintw(w, 11, 2, "  total %llu KB", (unsigned long long)(perf->term_bytes_total / 1024));
+    wrefresh(w);
+}
+
+//write the statistics of the panels in the log
+void report_panels(const Panels *p, const char *process_name){
+    log_message(process_name, "[UI] panels: %lu calls, %lu refresh rounds skipped, %lu lines formatted, %lu lines unchanged, %lu window refreshes",
+                p->calls, p->skipped, p->formatted, p->unchanged, p->refreshes);
+}
+
+//print the game mode under the map
+void print_mode(Screen *s, GameMode mode) {
+    const char *label = NULL;
+
+    switch (mode) {
+        case MODE_SERVER: label = "[ SERVER MODE ]"; break;
+        case MODE_CLIENT: label = "[ CLIENT MODE ]"; break;
+        case MODE_SOLO:   label = "[ SOLO MODE ]";   break;
+        default:          return;
+    }
+
+    int y = s->starty + s->height;
+    int x = s->startx + (s->width - strlen(label)) / 2;
+
+    attron(A_BOLD | COLOR_PAIR(4));
+    mvprintw(y, x, "%s", label);
+    attroff(A_BOLD | COLOR_PAIR(4));
+
+    refresh();
+}
+
+//used to print final statistics of END-GAME
+void show_final_win(const GameState *g) {
+    //clear the screen
+    clear(); 
+    refresh();
+
+    //open final statistics window
+    WINDOW *final_win = newwin(10, 50, LINES/2 - 5, COLS/2 - 25); 
+    box(final_win, 0, 0);
+
+    wattron(final_win, COLOR_PAIR(4) | A_BOLD);
+    mvwprintw(final_win, 1, 2, "You have collected ALL THE TARGETS!");
+    wattroff(final_win, COLOR_PAIR(4) | A_BOLD);      
+    mvwprintw(final_win, 3, 2, "Final Statistics:");
+    mvwprintw(final_win, 4, 4, "Score: %d", g->score);
+    mvwprintw(final_win, 5, 4, "Obstacles hit: %d", g->obstacles_hit_tot);
+    mvwprintw(final_win, 6, 4, "Fence collisions: %d", g->fence_collision_tot);
+    mvwprintw(final_win, 8, 2, "Press 'e' to exit");
+    wrefresh(final_win);
+
+    //exit game
+    nodelay(stdscr, FALSE);
+    int ch;
+    do {
+    ch = getch(); 
+    } while (ch != 'e' && ch != 'E');
+    delwin(final_win);
+}
@@ -0,0 +1,144 @@
+/* this file contains the live statistics of the blackboard loop
+    - fixed histograms and counters, reset every second (no allocation while measuring)
+    - bytes flushed to the terminal: written bytes of the process ('/proc/self/io') around the drawing
+    - summary of the last second for the overlay and for the renderer process
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "perf.h"
+#include "heartbeat.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define PERF_WINDOW_ms 1000
+
+//bytes written by the process until now (0 if not available)
+static uint64_t written_bytes(const PerfStats *p){
+    if (p->io_fd < 0) return 0;
+
+    char buf[512];
+    ssize_t n = pread(p->io_fd, buf, sizeof(buf) - 1, 0); //the kernel formats the file again at every read
+    if (n <= 0) return 0;
+    buf[n] = '\0';
+
+    const char *w = strstr(buf, "wchar:");
+    return w ? strtoull(w + 6, NULL, 10) : 0;
+}
+
+void perf_stats_init(PerfStats *p){
+    memset(p, 0, sizeof(*p));
+    p->io_fd = open("/proc/self/io", O_RDONLY);
+    p->window_start_ms = now_ms();
+    p->start_ms = p->window_start_ms;
+}
+
+void perf_stats_close(PerfStats *p){
+    if (p->io_fd >= 0) close(p->io_fd);
+    p->io_fd = -1;
+}
+
+//one iteration of the main loop is done
+void perf_loop_done(PerfStats *p, uint64_t wake_us){
+    uint64_t us = now_us() - wake_us;
+    perf_record(&p->loop, us);
+    perf_record(&p->loop_total, us);
+}
+
+//start of a frame (map, panels and overlay)
+void perf_render_begin(PerfStats *p){
+    p->render_start_wchar = written_bytes(p);
+    p->render_start_us = now_us();
+}
+
+//end of a frame: nothing else is written during the drawing, so the bytes are the terminal output
+void perf_render_end(PerfStats *p){
+    uint64_t us = now_us() - p->render_start_us;
+    perf_record(&p->render, us);
+    perf_record(&p->render_total, us);
+
+    uint64_t bytes = written_bytes(p) - p->render_start_wchar;
+    p->term_bytes += bytes;
+    p->term_bytes_total += bytes;
+
+    perf_trace_shown(p, now_us());
+}
+
+//one sample for each channel with effects waiting: the oldest one (the worst case of the frame)
+void perf_trace_shown(PerfStats *p, uint64_t now){
+    for (int i = 0; i < PERF_PIPES; i++) {
+        PerfTrace *t = &p->trace[i];
+        if (t->pending_us == 0) continue;
+        perf_record(&t->shown, now > t->pending_us ? now - t->pending_us : 0);
+        t->pending_us = 0;
+    }
+}
+
+//close the window every second: summary of the last window and reset of the counters
+int perf_stats_roll(PerfStats *p, uint64_t now){
+    uint64_t elapsed = now - p->window_start_ms;
+    if (elapsed < PERF_WINDOW_ms) return 0;
+
+    PerfSummary *s = &p->summary;
+    s->window++;
+    s->tick_hz = p->ticks * 1000.0 / elapsed;
+    s->loop_p50_us = perf_percentile(&p->loop, 50);
+    s->loop_p99_us = perf_percentile(&p->loop, 99);
+    s->render_p50_us = perf_percentile(&p->render, 50);
+    s->render_p99_us = perf_percentile(&p->render, 99);
+    s->frames = p->render.count;
+    for (int i = 0; i < PERF_PIPES; i++) s->pipe_msgs[i] = p->pipe_msgs[i] * 1000 / elapsed;
+    s->term_bytes_s = p->term_bytes * 1000 / elapsed;
+    s->term_bytes_total = p->term_bytes_total;
+    s->wakeups_s = p->wakeups * 1000 / elapsed;
+    s->dispatch_p50_us = perf_percentile(&p->dispatch, 50);
+    s->dispatch_p99_us = perf_percentile(&p->dispatch, 99);
+    memcpy(s->batch_max, p->batch_max, sizeof(s->batch_max));
+
+    perf_reset(&p->loop);
+    perf_reset(&p->render);
+    perf_reset(&p->dispatch);
+    p->wakeups = 0;
+    p->ticks = 0;
+    memset(p->pipe_msgs, 0, sizeof(p->pipe_msgs));
+    memset(p->batch_max, 0, sizeof(p->batch_max));
+    p->term_bytes = 0;
+    p->window_start_ms = now;
+    return 1;
+}
+
+//whole run statistics in the log
+void perf_stats_log(const PerfStats *p, const char *process_name){
+    perf_log(&p->loop_total, process_name, "loop (wake-up to end of iteration)");
+    perf_log(&p->render_total, process_name, "render (map + panels)");
+    perf_log(&p->dispatch_total, process_name, "timer dispatch delay");
+
+    //histograms of counts: the values are messages, not us
+    static const char *names[PERF_PIPES] = {"input", "drone", "targets", "obstacles"};
+    for (int i = 0; i < PERF_PIPES; i++) {
+        const PerfHist *h = &p->batch_total[i];
+        if (h->count == 0) continue;
+        log_message(process_name, "[PERF] %s batches: %llu drains, %llu messages, mean=%.2f p99<=%llu max=%llu", names[i],
+                    (unsigned long long)h->count, (unsigned long long)h->sum, (double)h->sum / h->count,
+                    (unsigned long long)perf_percentile(h, 99), (unsigned long long)h->max);
+    }
+    //where the latency of each channel goes (from the send time of the worker)
+    for (int i = 0; i < PERF_PIPES; i++) {
+        const PerfTrace *t = &p->trace[i];
+        if (t->received.count == 0) continue;
+        char what[64];
+        snprintf(what, sizeof(what), "%s latency send -> received", names[i]);
+        perf_log(&t->received, process_name, what);
+        snprintf(what, sizeof(what), "%s latency send -> applied", names[i]);
+        perf_log(&t->applied, process_name, what);
+        snprintf(what, sizeof(what), "%s latency send -> shown", names[i]);
+        perf_log(&t->shown, process_name, what);
+    }
+
+    uint64_t run_ms = now_ms() - p->start_ms;
+    log_message(process_name, "[PERF] event loop: %llu wake-ups in %llums (%.1f/s)", (unsigned long long)p->wakeups_total,
+                (unsigned long long)run_ms, run_ms ? p->wakeups_total * 1000.0 / run_ms : 0.0);
+    log_message(process_name, "[PERF] terminal: %llu bytes", (unsigned long long)p->term_bytes_total);
+}
@@ -1,5 +1,7 @@
 /* this file contains the function for the drone process
     - send a message periodically to the blackboard to update the drone position
+    - with '--physics <shm>' (PHYSICS_OWNER=drone) it integrates the drone dynamics itself:
+        reads commands and obstacles from the drone shm, writes position and velocity back, then sends the tick
 
     - use for the watchdog
         - maps the posix shared memory (heartbeat table)
@@ -15,64 +17,110 @@
 #include <sys/mman.h>  
 #include <sys/stat.h>  
 
+#include <string.h>
+
 #include "process_drone.h"
 #include "heartbeat.h"
 #include "logger.h"
+#include "runtime.h"
+#include "rt_profile.h"
+#include "transport.h"
+#include "messages.h"
+#include "drone_shm.h"
+#include "drone_physics.h"
+
+//one integration step with the commands received since the previous one
+static void physics_step(DroneShm *shm, GameState *gs, DroneCommands *applied){
+    static DroneCommands cmd; //static: obstacles copied at every step
+    drone_seq_read(&shm->cmd_seq, &cmd, &shm->cmd, sizeof(cmd));
+    drone_env_to_state(gs, &cmd);
+
+    //same order of the blackboard: brake, then the new direction
+    if (cmd.brakes != applied->brakes) use_brake(gs);
+    int mx = (int)(cmd.mx - applied->mx);
+    int my = (int)(cmd.my - applied->my);
+    if (mx != 0 || my != 0) add_direction(gs, mx, my);
+    applied->brakes = cmd.brakes;
+    applied->mx = cmd.mx;
+    applied->my = cmd.my;
+    applied->commands = cmd.commands;
+
+    add_drone_dynamics(gs);
+
+    drone_seq_begin(&shm->res_seq);
+    shm->res.steps++;
+    shm->res.commands = applied->commands;
+    drone_result_from_state(&shm->res, gs);
+    drone_seq_end(&shm->res_seq);
+}
 
-typedef struct  { //define the drone struct, divide the position in direction x and y
-    char type;
-    int x, y;
-} msgDrone;
-
-//send a tick to update the position 
-void move_drone(int fd, HeartbeatTable *hb, int slot){ 
+//send a tick to update the position (shm != NULL: integrate here first)
+void move_drone(Channel *ch, HeartbeatTable *hb, int slot, DroneShm *shm){ 
+    GameState gs; //local state of the integration (only the fields of drone_shm.h are used)
+    DroneCommands applied; //commands already applied
+    memset(&gs, 0, sizeof(gs));
+    memset(&applied, 0, sizeof(applied));
+    if (shm) {
+        DroneResult start; //initial state written by the blackboard
+        drone_seq_read(&shm->res_seq, &start, &shm->res, sizeof(start));
+        drone_result_to_state(&gs, &start);
+        gs.obstacles_hit = gs.fence_collision = 0;
+        drone_seq_read(&shm->cmd_seq, &applied, &shm->cmd, sizeof(applied)); //commands sent before the start are old
+    }
 
-    sem_wait(&hb->mutex); //lock the heartbeat table
-    //hb->entries[slot].last_seen_ms = now_ms(); //tells to watchdog it is awakes
-    hb->entries[slot].pid = getpid(); //save PID (used for the watchdog)
-    sem_post(&hb->mutex); //unlock the heartbeat table
+    hb_ready(hb, slot); //readiness barrier: table mapped and channel opened
 
-    while(1){
-        sem_wait(&hb->mutex); //lock the heartbeat table
-        hb->entries[slot].last_seen_ms = now_ms(); //tells to watchdog it is stil active
-        sem_post(&hb->mutex); //unlock the heartbeat table
+    while(runtime_running()){
+        hb_beat(hb, slot); //tells to watchdog it is stil active
+        uint64_t t0 = now_us();
         
+        if (shm) physics_step(shm, &gs, &applied);
+
         //send message to blackboard to update the drone position   
-        msgDrone msg = {'D', 0, 0};
-        ssize_t written = write(fd, &msg, sizeof(msg));
-        if (written != sizeof(msg)) {
+        msgDrone msg = {(int)gs.drone.x, (int)gs.drone.y};
+        if (msg_send(ch, 'D', &msg, sizeof(msg)) < 0) {
             perror("write failed");
-            log_message("DRONE", "ERROR: write returned %zd", written);
+            log_message("DRONE", "ERROR: cannot send the drone message");
         }
+        hb_loop(hb, slot, now_us() - t0, chan_pending(ch)); //tick: integration and message
         
         //used for the 'nanosleep' function
         struct timespec ts;
         ts.tv_sec = 0;
-        ts.tv_nsec = 20 * 1000 * 1000; // 20 ms
-        nanosleep(&ts, NULL);
+        ts.tv_nsec = DRONE_PERIOD_ms * 1000 * 1000; // 20 ms
+        runtime_sleep(&ts);
     }
 }
 
 
-int main(int argc, char *argv[])
+int WORKER_MAIN(drone)(int argc, char *argv[])
 {
     if (argc < 4) { 
         /*expected args:
             1. write_fd
             2. shm_name ('/heartbeat')
-            3. slot index ('2' for HB_SLOT_DRONE)
+            3. name of the heartbeat slot ('DRONE', any name for more workers of the same kind)
+            4. optional: '--ring' <ring shm> <eventfd> (TRANSPORT=ring)
+            5. optional: '--physics' <drone shm> (PHYSICS_OWNER=drone)
         */
-        fprintf(stderr, "Usage: %s <write_fd> <shm_name> <slot>\n", argv[0]);
+        fprintf(stderr, "Usage: %s <write_fd> <shm_name> <hb_name> [--ring <shm> <eventfd>] [--physics <shm>]\n", argv[0]);
         return 1;
     }
 
     //read the argv
-    int fd = atoi(argv[1]);
+    Channel ch; //pipe or shared memory ring toward the blackboard
+    chan_from_args(&ch, atoi(argv[1]), argc, argv);
     const char *shm_name = argv[2];
-    int slot = atoi(argv[3]);
+    const char *hb_name = argv[3]; //name of the heartbeat slot
+    const char *physics_name = NULL; //drone shm: this process integrates the dynamics
+    for (int i = 4; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--physics") == 0) physics_name = argv[i + 1];
+    }
 
-    log_message("DRONE", "Drone process awakes (PID: %d, slot: %d)", getpid(), slot); //start log
+    log_message("DRONE", "Drone process awakes (PID: %d, heartbeat: %s, transport: %s, physics: %s)", getpid(), hb_name,
+                chan_kind_name(&ch), physics_name ? "drone" : "blackboard"); //start log
     register_process("DRONE"); //register process_drone pid in the pid file
+    rt_mlock_from_env("DRONE"); //MLOCKALL=1 (the lock is not kept by exec)
 
     //open existing shared memory created by blackboard
     int hb_fd = shm_open(shm_name, O_RDWR, 0666);
@@ -88,12 +136,41 @@ int main(int argc, char *argv[])
         close(hb_fd); 
         return 1; 
     }
+    if (!hb_layout_ok(hb, "process_drone")) { //table of a build with another layout
+        munmap(hb, sizeof(HeartbeatTable));
+        close(hb_fd);
+        return 1;
+    }
+    int slot = hb_claim(hb, hb_name, getpid(), DRONE_PERIOD_ms, 0); //timeout of the watchdog
+    if (slot < 0) {
+        log_message("DRONE", "ERROR: no free heartbeat slot for %s", hb_name);
+        munmap(hb, sizeof(HeartbeatTable));
+        close(hb_fd);
+        return 1;
+    }
+
+    //map the drone shm (read the commands, write the result)
+    DroneShm *dshm = NULL;
+    if (physics_name) {
+        int d_fd = shm_open(physics_name, O_RDWR, 0666);
+        if (d_fd < 0) {
+            perror("process_drone physics shm_open");
+            return 1;
+        }
+        dshm = mmap(NULL, sizeof(DroneShm), PROT_READ | PROT_WRITE, MAP_SHARED, d_fd, 0);
+        close(d_fd);
+        if (dshm == MAP_FAILED) {
+            perror("process_drone physics mmap");
+            return 1;
+        }
+    }
 
-    move_drone(fd, hb, slot); //update position
+    move_drone(&ch, hb, slot, dshm); //update position
     log_message("DRONE", "Drone process shutdown");
 
+    if (dshm) munmap(dshm, sizeof(*dshm));
     munmap(hb, sizeof(*hb));
     close(hb_fd);
-    close(fd);
+    chan_close(&ch, 0);
     return 0;
 }
@@ -1,6 +1,8 @@
 /* this file contains the function for the process input
     - read input from the keybord
     - pass the given input to the server
+    - waits on stdin (no polling sleep): the message is written before the table is redrawn
+    - headless mode: read the same keys from a file, a fifo or a unix socket (no ncurses)
 
     - use for the watchdog
         - maps the posix shared memory (heartbeat table)
@@ -18,18 +20,22 @@
 #include <sys/mman.h>  
 #include <sys/stat.h>  
 #include <time.h>
+#include <string.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 
 #include "process_input.h"
 #include "heartbeat.h"
 #include "logger.h"
+#include "runtime.h"
+#include "perf.h"
+#include "transport.h"
+#include "messages.h"
 
 
 //-----------------------------------------------------------------------STRUCT
-typedef struct { //for the input force in the x and y coordinates
-    char type;
-    int dx, dy;
-} msgInput;
-
 typedef struct { //for mapping the input, create the 'table' of directions
     int row, col;
     char label;
@@ -41,8 +47,15 @@ KeyBox keymap[] = { //input map
     {2, 1, 'x'}, {2, 2, 'c'}, {2, 3, 'v'}
 };
 
+static volatile sig_atomic_t g_stop = 0; //SIGTERM from the blackboard
+
 //-----------------------------------------------------------------------FUNCTIONS
 
+static void on_sigterm(int sig) {
+    (void)sig;
+    g_stop = 1;
+}
+
 //function to draw the tables
 void draw_key_box(WINDOW *win, int y, int x, char label, int highlighted)
 {
@@ -76,6 +89,19 @@ void draw_key_box(WINDOW *win, int y, int x, char label, int highlighted)
     }
 }
 
+//position of the key in the table (return 0 if the key is not in the table)
+static int key_position(char label, int *y, int *x){
+    for (int i = 0; i < 9; i++) {
+        if (keymap[i].label != label) continue;
+
+        //centered key in the box
+        *y = 3 + keymap[i].row * 4;
+        *x = 8 + (keymap[i].col - 1) * 6;
+        return 1;
+    }
+    return 0;
+}
+
 //funcition to draw the keys in the table
 void draw_keys(WINDOW* win, char highlight)
 {
@@ -83,13 +109,9 @@ void draw_keys(WINDOW* win, char highlight)
     box(win, 0, 0);
 
     for (int i = 0; i < 9; i++) { //draw the table
-        int r = keymap[i].row;
-        int c = keymap[i].col;
+        int y, x;
         char label = keymap[i].label;
-
-        //centered key in the box
-        int y = 3 + r * 4;  
-        int x = 8 + (c - 1) * 6;
+        key_position(label, &y, &x);
 
         int pressed = (label == highlight); //selected key
 
@@ -99,88 +121,218 @@ void draw_keys(WINDOW* win, char highlight)
     wrefresh(win);
 }
 
+//move the highlight: redraw only the old and the new box
+static void highlight_key(WINDOW *win, char old_key, char new_key){
+    if (old_key == new_key) return;
+
+    int y, x;
+    if (key_position(old_key, &y, &x)) draw_key_box(win, y, x, old_key, 0);
+    if (key_position(new_key, &y, &x)) draw_key_box(win, y, x, new_key, 1);
+    wrefresh(win);
+}
+
+//convert a key into the message for the blackboard (return 0 if the key is not mapped)
+static int key_to_msg(int ch, char *type, msgInput *msg){
+    *type = 'I'; //messagge 'input'
+    msg->dx = 0;
+    msg->dy = 0;
+
+    switch (tolower(ch)) {
+        case 'w': msg->dx = -1; msg->dy = -1; break; //north-west
+        case 'e': msg->dx =  0; msg->dy = -1; break; //north
+        case 'r': msg->dx = +1; msg->dy = -1; break; //north-east
+        case 's': msg->dx = -1; msg->dy =  0; break; //west
+        case 'd': *type = 'B'; break; //message 'brake'
+        case 'f': msg->dx = +1; msg->dy =  0; break; //east
+        case 'x': msg->dx = -1; msg->dy = +1; break; //south-west
+        case 'c': msg->dx =  0; msg->dy = +1; break; //south
+        case 'v': msg->dx = +1; msg->dy = +1; break; //south-east
+        case 'q': *type = 'Q'; break; //message 'quit'
+        case 'o': *type = 'V'; break; //performance overlay on/off
+        case 'p': *type = 'P'; break; //reload parameters.config
+        case '+': case '=': *type = 'Z'; msg->dx = +1; break; //zoom in
+        case '-': *type = 'Z'; msg->dx = -1; break; //zoom out
+        default: return 0;
+    }
+    return 1;
+}
+
+//write the message on the pipe
+static void send_input(Channel *ch, char type, const msgInput *msg){
+    if (msg_send(ch, type, msg, sizeof(*msg)) < 0) {
+        perror("write failed");
+        log_message("INPUT", "ERROR: cannot send the '%c' message", type);
+    }
+}
+
 //function to define the key input
-void set_input(int fd, WINDOW* win, HeartbeatTable *hb, int slot){
-    nodelay(stdscr, TRUE);
-
-    //used for the 'nanosleep' function
-    struct timespec ts;
-    ts.tv_sec = 0;
-    ts.tv_nsec = 20 * 1000 * 1000; // 20 ms
-
-    while(1){ 
-        sem_wait(&hb->mutex); //lock the heartbeat table
-        hb->entries[slot].last_seen_ms = now_ms();   //tells to watchdog it is active
-        sem_post(&hb->mutex); //unlock the heartbeat table
-
-        int ch = getch();
-        if (ch == ERR) {        
-            nanosleep(&ts, NULL);
-            continue;            
+void set_input(Channel *chan, WINDOW* win, HeartbeatTable *hb, int slot, PerfHist *latency){
+    nodelay(stdscr, TRUE); //getch is called only when stdin is ready: read all the pending keys
+
+    char highlighted = 0; //key highlighted in the table
+
+    while(!g_stop){ 
+        hb_beat(hb, slot);   //tells to watchdog it is active
+
+        //sleep until a key arrives (the timeout keeps the heartbeat alive)
+        struct pollfd pfd = { .fd = STDIN_FILENO, .events = POLLIN };
+        if (poll(&pfd, 1, INPUT_HB_TIMEOUT_ms) <= 0) continue;
+        uint64_t t_ready = now_us(); //keypress available (also for the keys queued behind it)
+
+        int ch;
+        while ((ch = getch()) != ERR) {
+            //keypress selected: the message is sent before any cosmetic work
+            msgInput msg;
+            char type;
+            key_to_msg(ch, &type, &msg); //not mapped keys send a null force
+            send_input(chan, type, &msg);
+            perf_record(latency, now_us() - t_ready);
+
+            char key = tolower(ch); //keypress
+            highlight_key(win, highlighted, key); //only the changed boxes
+            highlighted = key;
+            log_message("INPUT", "%c key pressed", key);
+
+            //message 'quit'
+            if(type == 'Q') {
+                log_message("INPUT", "Quit key pressed");
+                return;
+            }
         }
+        hb_loop(hb, slot, now_us() - t_ready, chan_pending(chan)); //keys of one wake-up
+    }
+}
 
-        char key = tolower(ch); //keypress
-        log_message("INPUT", "%c key pressed", key);
-        draw_keys(win, key); //draw the table
-
-        //keypress selected
-        msgInput msg = {'I', 0, 0}; //messagge 'input'
-        if(ch == 'w' || ch=='W') { msg.dx = -1; msg.dy = -1; } //north-west
-        if(ch == 'e' || ch=='E') { msg.dx =  0; msg.dy = -1; } //north
-        if(ch == 'r' || ch=='R') { msg.dx = +1; msg.dy = -1; } //north-east
-        if(ch == 's' || ch=='S') { msg.dx = -1; msg.dy =  0; } //west
-        if(ch == 'd' || ch=='D') { msg.type = 'B'; } //message 'brake'
-        if(ch == 'f' || ch=='F') { msg.dx = +1; msg.dy =  0; } //east
-        if(ch == 'x' || ch=='X') { msg.dx = -1; msg.dy = +1; } //south-west
-        if(ch == 'c' || ch=='C') { msg.dx =  0; msg.dy = +1; } //south
-        if(ch == 'v' || ch=='V') { msg.dx = +1; msg.dy = +1; } //south-east
-        
-        //message 'quit'
-        if(ch == 'q' || ch == 'Q') {
-            log_message("INPUT", "Quit key pressed");
-            msgInput quit_msg = {'Q', 0, 0};
-            ssize_t written = write(fd, &quit_msg, sizeof(quit_msg));
-            if (written != sizeof(quit_msg)) {
-                perror("write failed");
-                log_message("INPUT", "ERROR: write returned %zd", written);
-            }
-            break; 
+//-----------------------------------------------------------------------HEADLESS
+//open the command source: '-' for stdin, 'unix:<path>' for a listening socket, otherwise a file or a fifo
+static int open_command_source(const char *src, int *listening){
+    *listening = 0;
+    if (!strcmp(src, "-")) return STDIN_FILENO;
+
+    if (!strncmp(src, "unix:", 5)) {
+        const char *path = src + 5;
+        int sfd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (sfd < 0) {
+            perror("process_input socket");
+            return -1;
+        }
+
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+        unlink(path); //remove an old socket file
+
+        if (bind(sfd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(sfd, 1) < 0) {
+            perror("process_input bind/listen");
+            close(sfd);
+            return -1;
+        }
+        *listening = 1;
+        return sfd;
+    }
+
+    return open(src, O_RDONLY | O_NONBLOCK); //non blocking: a fifo without writer does not stop the process
+}
+
+//headless input: same keys of the keyboard read from the command source, '.' waits 100 ms
+static void set_input_headless(Channel *ch, const char *src, HeartbeatTable *hb, int slot){
+    int listening = 0;
+    int lfd = open_command_source(src, &listening);
+    if (lfd < 0) {
+        log_message("INPUT", "ERROR: cannot open command source %s", src);
+        return;
+    }
+    log_message("INPUT", "Headless input reading commands from %s", src);
+
+    int cfd = listening ? -1 : lfd; //fd of the commands (for the socket: the accepted client)
+    int eof = 0; //file or stdin ended: only the heartbeat is updated
+
+    struct timespec pause_ts = {0, 100 * 1000 * 1000}; // 100 ms
+
+    while (runtime_running()) {
+        hb_beat(hb, slot);   //tells to watchdog it is active
+
+        struct pollfd pfd = { .fd = (cfd >= 0) ? cfd : lfd, .events = POLLIN };
+        int rc = poll(&pfd, eof ? 0 : 1, 100); //the timeout keeps the heartbeat alive
+        if (rc <= 0) continue;
+
+        //new client on the socket
+        if (cfd < 0) {
+            cfd = accept(lfd, NULL, NULL);
+            if (cfd >= 0) log_message("INPUT", "Command client connected");
+            continue;
         }
 
-        /*//read the parameters
-        if (ch == 'p' || ch == 'P') {
-        msgInput msg = {'P', 0, 0};
-        write(fd, &msg, sizeof(msg));
-        }*/
-        
-        ssize_t written = write(fd, &msg, sizeof(msg));
-        if (written != sizeof(msg)) {
-            perror("write failed");
-            log_message("INPUT", "ERROR: write returned %zd", written);
+        char buf[64];
+        ssize_t n = read(cfd, buf, sizeof(buf));
+        if (n < 0) continue; //fifo without writer (EAGAIN)
+        uint64_t t0 = now_us(); //commands until the next pause
+        if (n == 0) {
+            if (listening) { //client disconnected: wait for the next one
+                close(cfd);
+                cfd = -1;
+            } else if (pfd.revents & POLLHUP) { //fifo: the writer closed, wait for a new one
+                struct timespec ts = {0, 20 * 1000 * 1000};
+                nanosleep(&ts, NULL);
+            } else {
+                log_message("INPUT", "End of command file");
+                eof = 1;
+            }
+            continue;
         }
 
-        nanosleep(&ts, NULL);
+        for (ssize_t i = 0; i < n; i++) {
+            if (buf[i] == '.') { //pause used to script the commands
+                hb_loop(hb, slot, now_us() - t0, chan_pending(ch)); //the pause is not work of the loop
+                runtime_sleep(&pause_ts);
+                hb_beat(hb, slot);
+                t0 = now_us();
+                continue;
+            }
+
+            msgInput msg;
+            char type;
+            if (!key_to_msg(buf[i], &type, &msg)) continue; //spaces, new lines and unknown keys
+
+            send_input(ch, type, &msg);
+            if (type == 'Q') {
+                log_message("INPUT", "Quit command received");
+                if (cfd != lfd) close(cfd);
+                if (lfd != STDIN_FILENO) close(lfd);
+                return;
+            }
+        }
+        hb_loop(hb, slot, now_us() - t0, chan_pending(ch)); //commands after the last pause
     }
 }
 
 
-int main(int argc, char *argv[])
+int WORKER_MAIN(input)(int argc, char *argv[])
 {
     if (argc < 4) {
         /*expected args:
             1. write_fd
             2. shm_name ('/heartbeat')
-            3. slot index ('1' for HB_SLOT_INPUT)
+            3. name of the heartbeat slot ('INPUT', any name for more workers of the same kind)
+            4. optional: '--headless' <command source>
+            5. optional: '--ring' <ring shm> <eventfd> (TRANSPORT=ring)
         */
-        fprintf(stderr, "Usage: %s <write_fd> <shm_name> <slot>\n", argv[0]);
+        fprintf(stderr, "Usage: %s <write_fd> <shm_name> <hb_name> [--headless <commands>] [--ring <shm> <eventfd>]\n", argv[0]);
         return 1;
     }
     //read the argv
-    int fd = atoi(argv[1]);
+    Channel ch; //pipe or shared memory ring toward the blackboard
+    chan_from_args(&ch, atoi(argv[1]), argc, argv);
     const char *shm_name = argv[2];
-    int slot = atoi(argv[3]);
-
-    log_message("INPUT", "Input process awakes (PID: %d, slot: %d)", getpid(), slot); //sart log
+    const char *hb_name = argv[3]; //name of the heartbeat slot
+    const char *commands = NULL; //headless mode: no ncurses window
+    if (argc >= 6 && !strcmp(argv[4], "--headless")) commands = argv[5];
+#ifdef THREADED_RUNTIME
+    if (!commands) commands = "-"; //thread: no terminal of its own, the keys come from the terminal of the blackboard
+#endif
+
+    log_message("INPUT", "Input process awakes (PID: %d, heartbeat: %s, transport: %s)", getpid(), hb_name, chan_kind_name(&ch)); //sart log
     register_process("INPUT"); //register input process pid in the pid file
 
     //open existing shared memory created by blackboard
@@ -197,12 +349,37 @@ int main(int argc, char *argv[])
         close(hb_fd); 
         return 1; 
     }
+    if (!hb_layout_ok(hb, "process_input")) { //table of a build with another layout
+        munmap(hb, sizeof(HeartbeatTable));
+        close(hb_fd);
+        return 1;
+    }
+    int slot = hb_claim(hb, hb_name, getpid(), INPUT_HB_TIMEOUT_ms, 0); //timeout of the watchdog
+    if (slot < 0) {
+        log_message("INPUT", "ERROR: no free heartbeat slot for %s", hb_name);
+        munmap(hb, sizeof(HeartbeatTable));
+        close(hb_fd);
+        return 1;
+    }
+
+    hb_ready(hb, slot); //readiness barrier: table mapped and channel opened
+
+    if (commands) { //headless: no terminal is needed
+        set_input_headless(&ch, commands, hb, slot);
+
+        log_message("INPUT", "Input process shutdown");
+        munmap(hb, sizeof(*hb));
+        close(hb_fd);
+        chan_close(&ch, 0);
+        return 0;
+    }
 
-    //declare 'awaken' and save PID 
-    sem_wait(&hb->mutex); //lock the heartbeat table
-    //hb->entries[slot].last_seen_ms = now_ms();
-    hb->entries[slot].pid = getpid();
-    sem_post(&hb->mutex); //unlock the heartbeat table
+    //SIGTERM/SIGINT -> exit from the loop (poll is interrupted), close ncurses and log the latency
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_sigterm;
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGINT, &sa, NULL);
 
     //function to initialize the ncurses window
     initscr();
@@ -216,18 +393,21 @@ int main(int argc, char *argv[])
 
     WINDOW* win_keys = newwin(15, 30, 1, 1); //initializate the ncurses window
 
-    mvprintw(0, 0, "Input window (w e r / s d f / x c v) or 'q' to quit"); //print input legend
+    mvprintw(0, 0, "Input window (w e r / s d f / x c v), '+'/'-' zoom, 'o' overlay or 'q' to quit"); //print input legend
     refresh();
 
     draw_keys(win_keys, 0); //call the draw keys function
 
-    set_input(fd, win_keys, hb, slot); //define the input in the message
+    PerfHist latency; //keypress -> pipe write
+    perf_reset(&latency);
+    set_input(&ch, win_keys, hb, slot, &latency); //define the input in the message
 
+    perf_log(&latency, "INPUT", "keypress to pipe write");
     log_message("INPUT", "Input process shutdown");
     endwin();
     munmap(hb, sizeof(*hb));
     close(hb_fd);
-    close(fd);
+    chan_close(&ch, 0);
 
     return 0;
 }
\ No newline at end of file
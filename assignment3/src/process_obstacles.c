@@ -2,6 +2,7 @@
     - define the number of obstacles
     - pass the obstales coordinate to the server
     - respawn the obstacles after 30 seconds
+    - the messages carry only the obstacles of the config (frames of messages.h, no compile-time cap)
 */
 
 #define _POSIX_C_SOURCE 200809L
@@ -17,46 +18,23 @@
 #include "map.h" 
 #include "heartbeat.h"  
 #include "logger.h"
+#include "runtime.h"
+#include "transport.h"
+#include "messages.h"
+#include "config.h"
 
-typedef struct { //for the obstacle message, define the number of obstacles
-    char type;  
-    int num;
-    Obstacle obstacles[MAX_OBSTACLES];
-} msgObstacles;
 
+#define HB_STEP_ms 100 //heartbeat period while sleeping
 
-//--------------------------------------------------------------------------------------------------------FUNCTIONS
-//read the number of obstacles from the config file
-static void load_config(const char *path, Config *cfg){
-    memset(cfg, 0, sizeof(Config));
-
-    //read from the file config file
-    FILE *f = fopen(path, "r");
-    if(!f){
-        fprintf(stderr, "process_obstacles cannot open %s, using the default values\n", path);
-        return;
-    }
-
-    //parsing to define the values
-    char line[256];
-    while (fgets(line, sizeof(line), f)){
-        char key[128], value[128];
-        if (sscanf(line, "%127[^=]=%127s", key, value)==2){
-            if (!strcmp(key, "WORLD_WIDTH"))  cfg->world_width  = atoi(value);
-            else if (!strcmp(key, "WORLD_HEIGHT")) cfg->world_height = atoi(value);
-            else if (!strcmp(key, "NUM_OBSTACLES")) cfg->num_obstacles = atoi(value);
-            else if (!strcmp(key, "RELOC_PERIOD_ms")) cfg->obstacle_reloc = atoi(value);
-        }
-    }
-    fclose(f);
-}
 
+//--------------------------------------------------------------------------------------------------------FUNCTIONS
 //update the heartbeat when the process 'sleeping' betwen the tick -> the watchdog will see the process is still active
-static void sleep_with_heartbeat(HeartbeatTable *hb, int slot, uint64_t total_ms) {
-    const uint64_t step_ms = 100; //100ms 
+//returns early when the blackboard publishes a new config version
+static void sleep_with_heartbeat(HeartbeatTable *hb, int slot, uint64_t total_ms, const ConfigShm *cshm, uint32_t version) {
+    const uint64_t step_ms = HB_STEP_ms;
 
-    while (total_ms > 0) {
-        hb->entries[slot].last_seen_ms = now_ms();
+    while (total_ms > 0 && runtime_running() && config_version(cshm) == version) {
+        hb_beat(hb, slot);
 
         uint64_t cur = (total_ms > step_ms) ? step_ms : total_ms;
 
@@ -64,27 +42,56 @@ static void sleep_with_heartbeat(HeartbeatTable *hb, int slot, uint64_t total_ms
             .tv_sec  = cur / 1000,
             .tv_nsec = (cur % 1000) * 1000000L
         };
-        nanosleep(&ts, NULL);
+        runtime_sleep(&ts);
 
         total_ms -= cur;
     }
 }
 
+//number of obstacles of the config: one for each cell at most
+static int config_obstacles(const Config *cfg){
+    int num = cfg->num_obstacles;
+    if (num < 0) num = 0;
+    if (num > cfg->world_width * cfg->world_height) num = cfg->world_width * cfg->world_height;
+    return num;
+}
+
+//the blackboard applied a new parameters.config: copy the new version and resize the obstacles
+static void reload_obstacles(const ConfigShm *cshm, Config *cfg, Obstacle **storage, int *count){
+    Config next;
+    uint32_t version = config_read(cshm, &next);
+    int num = config_obstacles(&next);
+    Obstacle *resized = realloc(*storage, (num > 0 ? num : 1) * sizeof(Obstacle));
+    if (!resized) {
+        log_message("OBSTACLES", "WARNING: cannot resize the obstacles to %d, %d kept", num, *count);
+        return;
+    }
+    *cfg = next;
+    *storage = resized;
+    *count = num;
+    log_message("OBSTACLES", "Config version %u: %d obstacles in a %dx%d world", version, num, cfg->world_width, cfg->world_height);
+}
+
 //send tick to relocate obstacles
-static void relocation_obstacles(int fd, const Config *cfg, int n_obstacles, HeartbeatTable *hb, int slot){
-    while (1) {
-        sleep_with_heartbeat(hb, slot, (uint64_t)cfg->obstacle_reloc); //not used 'usleep' because we want to tells the activity during the sleep status
+static void relocation_obstacles(Channel *ch, const ConfigShm *cshm, uint32_t version, Config *cfg, Obstacle **storage, int *count,
+                                 HeartbeatTable *hb, int slot){
+    while (runtime_running()) {
+        sleep_with_heartbeat(hb, slot, (uint64_t)cfg->obstacle_reloc, cshm, version); //not used 'usleep' because we want to tells the activity during the sleep status
+        if (!runtime_running()) break;
+
+        if (config_version(cshm) != version) { //new config: relocation now with the new number
+            version = config_version(cshm);
+            reload_obstacles(cshm, cfg, storage, count);
+        }
+        Obstacle *obstacles = *storage;
+        int n_obstacles = *count;
 
-        sem_wait(&hb->mutex); //lock the heartbeat table
-        hb->entries[slot].last_seen_ms = now_ms(); //update the slot to tell it is active
-        sem_post(&hb->mutex); //unlock the heartbeat table
+        hb_beat(hb, slot); //update the slot to tell it is active
+        uint64_t t0 = now_us();
 
-        msgObstacles msgR;
-        msgR.type = 'R'; //'R' = respawn
-        msgR.num  = n_obstacles;
         int x,y;
 
-        for (int i = 0; i < msgR.num; i++) {
+        for (int i = 0; i < n_obstacles; i++) {
             int valid = 0;
             while (!valid) { //random position of obstacle until the position is valid
                 valid = 1;
@@ -93,46 +100,53 @@ static void relocation_obstacles(int fd, const Config *cfg, int n_obstacles, Hea
 
                 for (int j = 0; j < i; j++) {
                     //check overlap with other obstacles
-                    if (msgR.obstacles[j].x == x && msgR.obstacles[j].y == y) { 
+                    if (obstacles[j].x == x && obstacles[j].y == y) { 
                         valid = 0; 
                         break; 
                     }
                 }
             }
             //save new position
-            msgR.obstacles[i].x = x;
-            msgR.obstacles[i].y = y;
+            obstacles[i].x = x;
+            obstacles[i].y = y;
         }
         log_message("OBSTACLES", "Obstacles relocated");
 
-        ssize_t Rw = write(fd, &msgR, sizeof(msgR));
-        if (Rw != sizeof(msgR)) { //debug
+        if (msg_send_list(ch, 'R', obstacles, n_obstacles, sizeof(Obstacle)) < 0) { //'R' = respawn
             perror("Failed to send relocation message of obstacles");
             break;  
         }
+        hb_loop(hb, slot, now_us() - t0, chan_pending(ch)); //one relocation
     }
 }
 
 
 //--------------------------------------------------------------------------------------------------------MAIN
-int main(int argc, char *argv[]){
+int WORKER_MAIN(obstacles)(int argc, char *argv[]){
 
     //for the WATCHDOG 
     if (argc < 4) {
         /*expected args:
             1. write_fd
             2. shm_name ('/heartbeat')
-            3. slot index ('4' for HB_SLOT_OBSTACLES)
+            3. name of the heartbeat slot ('OBSTACLES', any name for more workers of the same kind)
+            4. optional: '--ring' <ring shm> <eventfd> (TRANSPORT=ring)
+            5. optional: '--resume' (restarted by the supervisor: no initial set, the blackboard keeps its obstacles)
         */
-        fprintf(stderr, "Usage: %s <write_fd> <shm_name> <slot>\n", argv[0]);
+        fprintf(stderr, "Usage: %s <write_fd> <shm_name> <hb_name> [--ring <shm> <eventfd>] [--resume]\n", argv[0]);
         return 1;
     }
     //read the argv
-    int fd = atoi(argv[1]);
+    Channel ch; //pipe or shared memory ring toward the blackboard
+    chan_from_args(&ch, atoi(argv[1]), argc, argv);
     const char *shm_name = argv[2];
-    int slot = atoi(argv[3]);
+    const char *hb_name = argv[3]; //name of the heartbeat slot
+    int resume = 0; //restart of a failed obstacles process
+    for (int i = 4; i < argc; i++) {
+        if (strcmp(argv[i], "--resume") == 0) resume = 1;
+    }
     //satrt log
-    log_message("OBSTACLES", "Obstacles process awakes (PID: %d, slot: %d)", getpid(), slot);
+    log_message("OBSTACLES", "Obstacles process awakes (PID: %d, heartbeat: %s, transport: %s)", getpid(), hb_name, chan_kind_name(&ch));
     register_process("OBSTACLES"); //register obstacles process pid in the pid file
     //open existing shared memory created by blackboard
     int hb_fd = shm_open(shm_name, O_RDWR, 0666);
@@ -147,25 +161,42 @@ int main(int argc, char *argv[]){
         close(hb_fd); 
         return 1; 
     }
-    //save PID and initialize activity
-    sem_wait(&hb->mutex); //lock the heartbeat table
-    //hb->entries[slot].last_seen_ms = now_ms();
-    hb->entries[slot].pid = getpid();
-    sem_post(&hb->mutex); //unlock the heartbeat table
+    if (!hb_layout_ok(hb, "process_obstacles")) { //table of a build with another layout
+        munmap(hb, sizeof(HeartbeatTable));
+        close(hb_fd);
+        return 1;
+    }
+    int slot = hb_claim(hb, hb_name, getpid(), HB_STEP_ms, 0); //timeout of the watchdog
+    if (slot < 0) {
+        log_message("OBSTACLES", "ERROR: no free heartbeat slot for %s", hb_name);
+        munmap(hb, sizeof(HeartbeatTable));
+        close(hb_fd);
+        return 1;
+    }
+    hb_ready(hb, slot); //readiness barrier: table mapped and channel opened
 
-    //initialize the parameters file 
+    //parameters: copy of the config published by the blackboard (the file only if the shm is missing)
     Config cfg;
-    load_config("bin/parameters.config", &cfg);
+    uint32_t version = 0;
+    const ConfigShm *cshm = config_shm_open();
+    if (cshm) {
+        version = config_read(cshm, &cfg);
+    } else if (config_load(CONFIG_PATH, &cfg) < 0) {
+        fprintf(stderr, "process_obstacles cannot open %s, using the default values\n", CONFIG_PATH);
+    }
+    if (!cshm) log_message("OBSTACLES", "WARNING: config shm not found, %s parsed", CONFIG_PATH);
 
-    //obstacles messages
-    msgObstacles msg;
-    msg.type = 'O'; 
-    msg.num = cfg.num_obstacles;
-    if(msg.num > MAX_OBSTACLES) msg.num = MAX_OBSTACLES; //check on the number of obstacles
+    //obstacles messages (sized to the config)
+    int num = config_obstacles(&cfg);
+    Obstacle *obstacles = calloc(num > 0 ? num : 1, sizeof(Obstacle));
+    if (!obstacles) {
+        perror("process_obstacles calloc");
+        return 1;
+    }
 
     srand(time(NULL)^getpid()); //function to generate random values
 
-    for(int i=0; i<msg.num; i++){  //for every obstacles send a message with its position
+    for(int i=0; i<num; i++){  //for every obstacles send a message with its position
         int obstacle_x, obstacle_y;
         int valid_position=0;
 
@@ -177,7 +208,7 @@ int main(int argc, char *argv[]){
             //check position: if there another obstacle in that position
             int overlap_o = 0;
             for(int j=0; j<i; j++){
-                if(msg.obstacles[j].x==obstacle_x && msg.obstacles[j].y==obstacle_y){
+                if(obstacles[j].x==obstacle_x && obstacles[j].y==obstacle_y){
                     overlap_o = 1;
                     break;
                 }
@@ -186,19 +217,24 @@ int main(int argc, char *argv[]){
             valid_position = 1;
         }
 
-        msg.obstacles[i].x = obstacle_x;
-        msg.obstacles[i].y = obstacle_y;
+        obstacles[i].x = obstacle_x;
+        obstacles[i].y = obstacle_y;
     }
-    log_message("OBSTACLES", "Spawned %d obstacles initially", msg.num);
-
-    ssize_t written = write(fd, &msg, sizeof(msg));
-    if (written != sizeof(msg)) {
-        perror("write failed");
-        log_message("OBSTACLES", "ERROR: write returned %zd", written);
+    if (resume) { //the obstacles of the session are in the game state: they change with the next relocation
+        log_message("OBSTACLES", "Restarted: %d obstacles kept by the blackboard until the next relocation", num);
+    } else {
+        log_message("OBSTACLES", "Spawned %d obstacles initially", num);
+
+        if (msg_send_list(&ch, 'O', obstacles, num, sizeof(Obstacle)) < 0) {
+            perror("write failed");
+            log_message("OBSTACLES", "ERROR: cannot send the obstacles message");
+        }
     }
       
-    relocation_obstacles(fd, &cfg, msg.num, hb, slot); //after tick - respawn
-    close(fd);
+    relocation_obstacles(&ch, cshm, version, &cfg, &obstacles, &num, hb, slot); //after tick - respawn (resized by a reload)
+    chan_close(&ch, 0);
+    free(obstacles);
+    config_shm_close(cshm, 0);
 
     log_message("OBSTACLES", "Obstacles process shutdown");
 
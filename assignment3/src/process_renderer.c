@@ -0,0 +1,210 @@
+/* this file contains the function for the renderer process
+    - maps read-only the GameState snapshot published by the blackboard (state shm)
+    - draws the map and the inspection windows at its own pace (RENDER_FPS)
+    - a slow terminal stalls only this process, not the physics of the blackboard
+    - shows the final statistics when the game is over
+
+    - use for the watchdog
+        - maps the posix shared memory (heartbeat table)
+        - periodically updates its slow with monotonic timestamp
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include "map.h"
+#include "camera.h"
+#include "panels.h"
+#include "heartbeat.h"
+#include "state_shm.h"
+#include "logger.h"
+
+static volatile sig_atomic_t g_stop = 0; //SIGTERM from the blackboard
+
+static void on_sigterm(int sig) {
+    (void)sig;
+    g_stop = 1;
+}
+
+//draw the snapshots until the blackboard stops
+static void render_loop(const StateShm *state, HeartbeatTable *hb, int slot, int fps, int panel_refresh_ms){
+    Screen screen;
+    Panels panels;
+    StateSnapshot snap;
+    PerfStats perf; //render time and terminal bytes of this process
+    perf_stats_init(&perf);
+
+    state_read(state, &snap);
+    init_screen(&screen, snap.mode != MODE_SOLO);
+    print_mode(&screen, snap.mode);
+    if (snap.mode == MODE_SOLO) init_panels(&panels, panel_refresh_ms);
+
+    int old_lines = LINES;
+    int old_cols  = COLS;
+    uint64_t last_tick = (uint64_t)-1; //draw the first snapshot
+
+    //used for the 'nanosleep' function
+    struct timespec ts;
+    ts.tv_sec = 0;
+    ts.tv_nsec = 1000L * 1000 * 1000 / fps;
+
+    while (!g_stop) {
+        hb_beat(hb, slot); //tells to watchdog it is active
+        uint64_t t0 = now_us();
+
+        state_read(state, &snap);
+        if (!snap.running) break;
+
+        //resize
+        if (LINES != old_lines || COLS != old_cols) {
+            old_lines = LINES;
+            old_cols  = COLS;
+            refresh_screen(&screen, snap.mode != MODE_SOLO);
+            print_mode(&screen, snap.mode);
+            if (snap.mode == MODE_SOLO) invalidate_panels(&panels);
+            last_tick = (uint64_t)-1;
+        }
+
+        if (snap.game_over) { //END-GAME
+            log_message("RENDERER", "Open the final statistics");
+            show_final_win(&snap.gs);
+            break;
+        }
+
+        if (snap.tick != last_tick) { //draw only new states
+            last_tick = snap.tick;
+            perf_render_begin(&perf);
+            render(&screen, &snap.gs);
+            if (snap.mode == MODE_SOLO) {
+                draw_panels(&panels, &snap.gs, snap.pids);
+
+                //overlay: loop, ticks and pipes of the blackboard, drawing of this process
+                PerfSummary sum = snap.perf;
+                sum.window += perf.summary.window; //changes when one of the two summaries changes
+                sum.render_p50_us = perf.summary.render_p50_us;
+                sum.render_p99_us = perf.summary.render_p99_us;
+                sum.frames = perf.summary.frames;
+                sum.term_bytes_s = perf.summary.term_bytes_s;
+                sum.term_bytes_total = perf.summary.term_bytes_total;
+                set_overlay(&panels, snap.gs.overlay);
+                draw_overlay(&panels, &sum);
+            }
+            perf_render_end(&perf);
+        }
+        perf_stats_roll(&perf, now_ms());
+        hb_loop(hb, slot, now_us() - t0, 0); //one frame (no channel: the snapshot is read from the state shm)
+
+        nanosleep(&ts, NULL);
+    }
+
+    if (snap.mode == MODE_SOLO) report_panels(&panels, "RENDERER");
+    perf_log(&perf.render_total, "RENDERER", "render (map + panels)");
+    log_message("RENDERER", "[PERF] terminal: %llu bytes", (unsigned long long)perf.term_bytes_total);
+    perf_stats_close(&perf);
+    camera_free(&screen.cam);
+}
+
+
+int main(int argc, char *argv[])
+{
+    if (argc < 5) {
+        /*expected args:
+            1. state shm name ('/gamestate')
+            2. shm_name ('/heartbeat')
+            3. name of the heartbeat slot ('RENDERER', any name for more workers of the same kind)
+            4. frames per second
+            5. (optional) ms between two updates of the panels
+        */
+        fprintf(stderr, "Usage: %s <state_shm> <shm_name> <hb_name> <fps> [panel_refresh_ms]\n", argv[0]);
+        return 1;
+    }
+
+    //read the argv
+    const char *state_name = argv[1];
+    const char *shm_name = argv[2];
+    const char *hb_name = argv[3]; //name of the heartbeat slot
+    int fps = atoi(argv[4]);
+    if (fps <= 0) fps = 30;
+    int panel_refresh_ms = argc > 5 ? atoi(argv[5]) : 100;
+
+    log_message("RENDERER", "Renderer process awakes (PID: %d, heartbeat: %s, %d fps)", getpid(), hb_name, fps); //start log
+    register_process("RENDERER"); //register renderer pid in the pid file
+
+    //SIGTERM -> exit from the loop and close ncurses (terminal not left in raw mode)
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_sigterm;
+    sigaction(SIGTERM, &sa, NULL);
+
+    //open existing shared memory created by blackboard
+    int hb_fd = shm_open(shm_name, O_RDWR, 0666);
+    if (hb_fd < 0) { 
+        perror("process_renderer shm_open"); 
+        return 1; 
+    }
+
+    //map heartbeat table
+    HeartbeatTable *hb = mmap(NULL, sizeof(HeartbeatTable), PROT_READ | PROT_WRITE, MAP_SHARED, hb_fd, 0);
+    if (hb == MAP_FAILED) { 
+        perror("process_renderer mmap"); 
+        close(hb_fd); 
+        return 1; 
+    }
+    if (!hb_layout_ok(hb, "process_renderer")) { //table of a build with another layout
+        munmap(hb, sizeof(HeartbeatTable));
+        close(hb_fd);
+        return 1;
+    }
+    int slot = hb_claim(hb, hb_name, getpid(), (uint32_t)(1000 / fps), 0); //timeout of the watchdog
+    if (slot < 0) {
+        log_message("RENDERER", "ERROR: no free heartbeat slot for %s", hb_name);
+        munmap(hb, sizeof(HeartbeatTable));
+        close(hb_fd);
+        return 1;
+    }
+
+    //map the state snapshot (read-only)
+    int st_fd = shm_open(state_name, O_RDONLY, 0666);
+    if (st_fd < 0) { 
+        perror("process_renderer state shm_open"); 
+        return 1; 
+    }
+    const StateShm *state = mmap(NULL, sizeof(StateShm), PROT_READ, MAP_SHARED, st_fd, 0);
+    if (state == MAP_FAILED) { 
+        perror("process_renderer state mmap"); 
+        close(st_fd); 
+        return 1; 
+    }
+
+    hb_ready(hb, slot); //readiness barrier: heartbeat table and state mapped
+
+    //ncurses (same colors of the blackboard)
+    initscr();
+    start_color();
+    init_pair(1, COLOR_YELLOW, COLOR_BLACK); //yellow target
+    init_pair(2, COLOR_MAGENTA, COLOR_BLACK); //magenta obstacles
+    init_pair(3, COLOR_GREEN, COLOR_BLACK); //green drone
+    init_pair(4, COLOR_CYAN, COLOR_BLACK); //cyan color
+    noecho();
+    curs_set(0);
+
+    render_loop(state, hb, slot, fps, panel_refresh_ms);
+
+    endwin();
+    log_message("RENDERER", "Renderer process shutdown");
+
+    munmap((void *)state, sizeof(StateShm));
+    close(st_fd);
+    munmap(hb, sizeof(*hb));
+    close(hb_fd);
+    return 0;
+}
@@ -2,6 +2,7 @@
     - define the number of targets
     - pass the targets coordinate to the server
     - respawn the targets after 30 seconds
+    - the messages carry only the targets of the config (frames of messages.h, no compile-time cap)
     
     - use for the watchdog
         - maps the posix shared memory (heartbeat table)
@@ -21,46 +22,23 @@
 #include "map.h"  
 #include "heartbeat.h"
 #include "logger.h"
+#include "runtime.h"
+#include "transport.h"
+#include "messages.h"
+#include "config.h"
 
-typedef struct { //for the target message, define the number of targets
-    char type;  
-    int num;
-    Target targets[MAX_TARGETS];
-} msgTargets;
 
+#define HB_STEP_ms 100 //heartbeat period while sleeping
 
-//----------------------------------------------------------------------------------------------------------FUNCTION
-//read the number of obstacles from the config file
-static void load_config(const char *path, Config *cfg){
-    memset(cfg, 0, sizeof(Config));
-
-    //read from the file config
-    FILE *f = fopen(path, "r");
-    if(!f){
-        fprintf(stderr, "process_targets cannot open %s, using the default values\n", path);
-        return;
-    }
-
-    //parsing to define the values
-    char line[256];
-    while (fgets(line, sizeof(line), f)){
-        char key[128], value[128];
-        if (sscanf(line, "%127[^=]=%127s", key, value)==2){
-            if (!strcmp(key, "WORLD_WIDTH"))  cfg->world_width  = atoi(value);
-            else if (!strcmp(key, "WORLD_HEIGHT")) cfg->world_height = atoi(value);
-            else if (!strcmp(key, "NUM_TARGETS")) cfg->num_targets = atoi(value);
-            else if (!strcmp(key, "RELOC_PERIOD_ms")) cfg->target_reloc = atoi(value);
-        }
-    }
-    fclose(f);
-}
 
+//----------------------------------------------------------------------------------------------------------FUNCTION
 //update the heartbeat when the process 'sleeping' betwen the tick -> the watchdog will see the process is still active
-static void sleep_with_heartbeat(HeartbeatTable *hb, int slot, uint64_t total_ms) {
-    const uint64_t step_ms = 100; //100ms 
+//returns early when the blackboard publishes a new config version
+static void sleep_with_heartbeat(HeartbeatTable *hb, int slot, uint64_t total_ms, const ConfigShm *cshm, uint32_t version) {
+    const uint64_t step_ms = HB_STEP_ms;
 
-    while (total_ms > 0) {
-        hb->entries[slot].last_seen_ms = now_ms();
+    while (total_ms > 0 && runtime_running() && config_version(cshm) == version) {
+        hb_beat(hb, slot);
 
         uint64_t cur = (total_ms > step_ms) ? step_ms : total_ms;
 
@@ -68,28 +46,57 @@ static void sleep_with_heartbeat(HeartbeatTable *hb, int slot, uint64_t total_ms
             .tv_sec  = cur / 1000,
             .tv_nsec = (cur % 1000) * 1000000L
         };
-        nanosleep(&ts, NULL);
+        runtime_sleep(&ts);
 
         total_ms -= cur;
     }
 }
 
 
+//number of targets of the config: one for each cell at most
+static int config_targets(const Config *cfg){
+    int num = cfg->num_targets;
+    if (num < 0) num = 0;
+    if (num > cfg->world_width * cfg->world_height) num = cfg->world_width * cfg->world_height;
+    return num;
+}
+
+//the blackboard applied a new parameters.config: copy the new version and resize the targets
+static void reload_targets(const ConfigShm *cshm, Config *cfg, Target **storage, int *count){
+    Config next;
+    uint32_t version = config_read(cshm, &next);
+    int num = config_targets(&next);
+    Target *resized = realloc(*storage, (num > 0 ? num : 1) * sizeof(Target));
+    if (!resized) {
+        log_message("TARGETS", "WARNING: cannot resize the targets to %d, %d kept", num, *count);
+        return;
+    }
+    *cfg = next;
+    *storage = resized;
+    *count = num;
+    log_message("TARGETS", "Config version %u: %d targets in a %dx%d world", version, num, cfg->world_width, cfg->world_height);
+}
+
 //send tick to relocate targets
-static void relocation_targets(int fd, const Config *cfg, int n_targets, HeartbeatTable *hb, int slot){
-    while (1) {
-        sleep_with_heartbeat(hb, slot, (uint64_t)cfg->target_reloc); //not used 'usleep' because we want to tells the activity during the sleep status
+static void relocation_targets(Channel *ch, const ConfigShm *cshm, uint32_t version, Config *cfg, Target **storage, int *count,
+                                 HeartbeatTable *hb, int slot){
+    while (runtime_running()) {
+        sleep_with_heartbeat(hb, slot, (uint64_t)cfg->target_reloc, cshm, version); //not used 'usleep' because we want to tells the activity during the sleep status
+        if (!runtime_running()) break;
+
+        if (config_version(cshm) != version) { //new config: relocation now with the new number
+            version = config_version(cshm);
+            reload_targets(cshm, cfg, storage, count);
+        }
+        Target *targets = *storage;
+        int n_targets = *count;
 
-        sem_wait(&hb->mutex); //lock the heartbeat table
-        hb->entries[slot].last_seen_ms = now_ms(); //update the slot to tell it is active
-        sem_post(&hb->mutex); //unlock the heartbeat table
+        hb_beat(hb, slot); //update the slot to tell it is active
+        uint64_t t0 = now_us();
 
-        msgTargets msgR;
-        msgR.type = 'R';  //'R' = respawn
-        msgR.num  = n_targets;
         int x,y;
 
-        for (int i = 0; i < msgR.num; i++) {
+        for (int i = 0; i < n_targets; i++) {
             int valid = 0;
             while (!valid) { //random position of target until the position is valid
                 valid = 1;
@@ -98,47 +105,54 @@ static void relocation_targets(int fd, const Config *cfg, int n_targets, Heartbe
 
                 for (int j = 0; j < i; j++) {
                     //check overlap with other targets
-                    if (msgR.targets[j].x == x && msgR.targets[j].y == y) { 
+                    if (targets[j].x == x && targets[j].y == y) { 
                         valid = 0; 
                         break; 
                     }
                 }
             }
             //save new position
-            msgR.targets[i].x = x;
-            msgR.targets[i].y = y;
+            targets[i].x = x;
+            targets[i].y = y;
         }
         log_message("TARGETS", "Targets relocated");
 
-        ssize_t Rw = write(fd, &msgR, sizeof(msgR));
-        if (Rw != sizeof(msgR)) { //debug
+        if (msg_send_list(ch, 'R', targets, n_targets, sizeof(Target)) < 0) { //'R' = respawn
             perror("Failed to send relocation message of targets");
             break;  
         }
+        hb_loop(hb, slot, now_us() - t0, chan_pending(ch)); //one relocation
     }
 }
 
 
 
 //----------------------------------------------------------------------------------------------------------MAIN
-int main(int argc, char *argv[]){
+int WORKER_MAIN(targets)(int argc, char *argv[]){
     
     //for the WATCHDOG: 
     if (argc < 4) {
         /*expected args:
             1. write_fd
             2. shm_name ('/heartbeat')
-            3. slot index ('3' for HB_SLOT_TARGETS)
+            3. name of the heartbeat slot ('TARGETS', any name for more workers of the same kind)
+            4. optional: '--ring' <ring shm> <eventfd> (TRANSPORT=ring)
+            5. optional: '--resume' (restarted by the supervisor: no initial set, the blackboard keeps its targets)
         */
-        fprintf(stderr, "Usage: %s <write_fd> <shm_name> <slot>\n", argv[0]);
+        fprintf(stderr, "Usage: %s <write_fd> <shm_name> <hb_name> [--ring <shm> <eventfd>] [--resume]\n", argv[0]);
         return 1;
     }
     //read the argv
-    int fd = atoi(argv[1]);
+    Channel ch; //pipe or shared memory ring toward the blackboard
+    chan_from_args(&ch, atoi(argv[1]), argc, argv);
     const char *shm_name = argv[2];
-    int slot = atoi(argv[3]);
+    const char *hb_name = argv[3]; //name of the heartbeat slot
+    int resume = 0; //restart of a failed targets process
+    for (int i = 4; i < argc; i++) {
+        if (strcmp(argv[i], "--resume") == 0) resume = 1;
+    }
     //start log
-    log_message("TARGETS", "Targets process awakes (PID: %d, slot: %d)", getpid(), slot); 
+    log_message("TARGETS", "Targets process awakes (PID: %d, heartbeat: %s, transport: %s)", getpid(), hb_name, chan_kind_name(&ch)); 
     register_process("TARGETS"); //register target process pid in the pid file
     //open existing shared memory created by blackboard
     int hb_fd = shm_open(shm_name, O_RDWR, 0666);
@@ -153,25 +167,42 @@ int main(int argc, char *argv[]){
         close(hb_fd); 
         return 1; 
     }
-    //save PID and initialize activity
-    sem_wait(&hb->mutex); //lock the heartbeat table
-    //hb->entries[slot].last_seen_ms = now_ms();
-    hb->entries[slot].pid = getpid();
-    sem_post(&hb->mutex); //unlock the heartbeat table
+    if (!hb_layout_ok(hb, "process_targets")) { //table of a build with another layout
+        munmap(hb, sizeof(HeartbeatTable));
+        close(hb_fd);
+        return 1;
+    }
+    int slot = hb_claim(hb, hb_name, getpid(), HB_STEP_ms, 0); //timeout of the watchdog
+    if (slot < 0) {
+        log_message("TARGETS", "ERROR: no free heartbeat slot for %s", hb_name);
+        munmap(hb, sizeof(HeartbeatTable));
+        close(hb_fd);
+        return 1;
+    }
+    hb_ready(hb, slot); //readiness barrier: table mapped and channel opened
 
-    //initialize the parameters file 
+    //parameters: copy of the config published by the blackboard (the file only if the shm is missing)
     Config cfg;
-    load_config("bin/parameters.config", &cfg);
+    uint32_t version = 0;
+    const ConfigShm *cshm = config_shm_open();
+    if (cshm) {
+        version = config_read(cshm, &cfg);
+    } else if (config_load(CONFIG_PATH, &cfg) < 0) {
+        fprintf(stderr, "process_targets cannot open %s, using the default values\n", CONFIG_PATH);
+    }
+    if (!cshm) log_message("TARGETS", "WARNING: config shm not found, %s parsed", CONFIG_PATH);
 
-    //targets messages
-    msgTargets msg;
-    msg.type = 'T';
-    msg.num = cfg.num_targets;
-    if(msg.num > MAX_TARGETS) msg.num = MAX_TARGETS; //check on the number of targets
+    //targets messages (sized to the config)
+    int num = config_targets(&cfg);
+    Target *targets = calloc(num > 0 ? num : 1, sizeof(Target));
+    if (!targets) {
+        perror("process_targets calloc");
+        return 1;
+    }
 
     srand(time(NULL)^getpid()); //function to generate random values
 
-    for(int i=0; i<msg.num; i++){ //for every targets send a message with its position
+    for(int i=0; i<num; i++){ //for every targets send a message with its position
         int target_x, target_y;
         int valid_position=0;
 
@@ -183,7 +214,7 @@ int main(int argc, char *argv[]){
 
             //check overlap with another target 
             for (int j = 0; j < i; j++) {
-                if (msg.targets[j].x == target_x && msg.targets[j].y == target_y) {
+                if (targets[j].x == target_x && targets[j].y == target_y) {
                     valid_position = 0;
                     break;
                 }
@@ -191,19 +222,24 @@ int main(int argc, char *argv[]){
         }
         
         //save new positions
-        msg.targets[i].x = target_x;
-        msg.targets[i].y = target_y;
+        targets[i].x = target_x;
+        targets[i].y = target_y;
     }
-    log_message("TARGETS", "Spawned %d targets initially", msg.num);
-
-    ssize_t written = write(fd, &msg, sizeof(msg)); //spawn the targets
-    if (written != sizeof(msg)) {
-        perror("write failed");
-        log_message("TARGETS", "ERROR: write returned %zd", written);
+    if (resume) { //the targets of the session are in the game state: they change with the next relocation
+        log_message("TARGETS", "Restarted: %d targets kept by the blackboard until the next relocation", num);
+    } else {
+        log_message("TARGETS", "Spawned %d targets initially", num);
+
+        if (msg_send_list(&ch, 'T', targets, num, sizeof(Target)) < 0) { //spawn the targets
+            perror("write failed");
+            log_message("TARGETS", "ERROR: cannot send the targets message");
+        }
     }
 
-    relocation_targets(fd, &cfg, msg.num, hb, slot); //after tick - respawn
-    close(fd); 
+    relocation_targets(&ch, cshm, version, &cfg, &targets, &num, hb, slot); //after tick - respawn (resized by a reload)
+    chan_close(&ch, 0);
+    free(targets);
+    config_shm_close(cshm, 0);
 
     log_message("TARGETS", "Targets process shutdown");
 
@@ -0,0 +1,88 @@
+/* this file contains the function for the event loop of the blackboard
+    - epoll instance and registration of the fds
+    - timerfd periodic timers and their dispatch delay
+    - signalfd for the shutdown signals
+*/
+
+#define _GNU_SOURCE
+
+#include "reactor.h"
+#include "perf.h"
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/signalfd.h>
+
+int reactor_create(void){
+    return epoll_create1(EPOLL_CLOEXEC);
+}
+
+int reactor_add(int epfd, int fd, uint32_t tag){
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u32 = tag;
+    return epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+int reactor_del(int epfd, int fd){
+    return epoll_ctl(epfd, EPOLL_CTL_DEL, fd, NULL);
+}
+
+//periodic timer on the monotonic clock
+int reactor_timer(ReactorTimer *t, uint64_t period_ms){
+    memset(t, 0, sizeof(*t));
+    t->fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (t->fd < 0) return -1;
+
+    struct itimerspec its;
+    its.it_interval.tv_sec = period_ms / 1000;
+    its.it_interval.tv_nsec = (long)(period_ms % 1000) * 1000000L;
+    its.it_value = its.it_interval;
+
+    t->period_us = period_ms * 1000;
+    t->start_us = now_us();
+    if (timerfd_settime(t->fd, 0, &its, NULL) < 0) {
+        close(t->fd);
+        t->fd = -1;
+        return -1;
+    }
+    return t->fd;
+}
+
+//read the expirations of a ready timer
+uint64_t reactor_timer_fire(ReactorTimer *t, uint64_t now, uint64_t *late_us){
+    uint64_t exp = 0;
+    if (read(t->fd, &exp, sizeof(exp)) != sizeof(exp)) return 0; //EAGAIN: already read
+
+    t->expirations += exp;
+    uint64_t due = t->start_us + t->expirations * t->period_us; //last expiration
+    if (late_us) *late_us = (now > due) ? now - due : 0;
+    return exp;
+}
+
+//block the signals and read them from a signalfd
+int reactor_signals(const int *sigs, int n){
+    sigset_t mask;
+    sigemptyset(&mask);
+    for (int i = 0; i < n; i++) sigaddset(&mask, sigs[i]);
+
+    if (sigprocmask(SIG_BLOCK, &mask, NULL) == -1) return -1;
+    return signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+}
+
+int reactor_signal_read(int sfd){
+    int value;
+    return reactor_signal_info(sfd, &value);
+}
+
+int reactor_signal_info(int sfd, int *value){
+    struct signalfd_siginfo si;
+    ssize_t n = read(sfd, &si, sizeof(si));
+    *value = 0;
+    if (n != sizeof(si)) return 0;
+    *value = si.ssi_int;
+    return (int)si.ssi_signo;
+}
@@ -0,0 +1,66 @@
+/* this file contains the scheduling profile of the tick path (rt_profile.h)
+    - core affinity and SCHED_FIFO of the calling process
+    - mlockall of the current and future pages
+    - every change is logged with the process name, a failure does not stop the process
+*/
+
+#define _GNU_SOURCE
+
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/mman.h>
+
+#include "rt_profile.h"
+#include "logger.h"
+
+int rt_apply(const char *name, int cpu, int priority){
+    int rc = 0;
+
+    if (cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        if (sched_setaffinity(0, sizeof(set), &set) < 0) {
+            log_message(name, "WARNING: cannot pin to cpu %d (%s)", cpu, strerror(errno));
+            rc = -1;
+        } else {
+            log_message(name, "Pinned to cpu %d", cpu);
+        }
+    }
+
+    if (priority > 0) {
+        struct sched_param sp;
+        memset(&sp, 0, sizeof(sp));
+        sp.sched_priority = priority;
+        if (sched_setscheduler(0, SCHED_FIFO, &sp) < 0) {
+            log_message(name, "WARNING: cannot set SCHED_FIFO %d (%s)", priority, strerror(errno));
+            rc = -1;
+        } else {
+            log_message(name, "Scheduler SCHED_FIFO priority %d", priority);
+        }
+    }
+    return rc;
+}
+
+int rt_mlock(const char *name){
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0) {
+        log_message(name, "WARNING: mlockall failed (%s)", strerror(errno));
+        return -1;
+    }
+    log_message(name, "Memory locked (mlockall)");
+    return 0;
+}
+
+void rt_child(const char *name, int cpu, int priority, int mlock){
+    rt_apply(name, cpu, priority);
+    if (mlock) setenv(RT_MLOCK_ENV, "1", 1);
+    else unsetenv(RT_MLOCK_ENV);
+}
+
+int rt_mlock_from_env(const char *name){
+    const char *v = getenv(RT_MLOCK_ENV);
+    if (!v || strcmp(v, "1") != 0) return 0;
+    return rt_mlock(name);
+}
@@ -0,0 +1,81 @@
+/* this file contains the threaded runtime of the blackboard (only with -DTHREADED_RUNTIME)
+    - starts the workers as threads with a copy of their arguments
+    - the signals are blocked in the workers: SIGUSR1, SIGINT and SIGHUP go to the signalfd of the blackboard
+    - stop flag checked by the loops of the workers, join at the shutdown
+*/
+
+#ifdef THREADED_RUNTIME
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "runtime.h"
+#include "logger.h"
+
+#define RUNTIME_MAX_WORKERS 8
+#define RUNTIME_MAX_ARGS 16
+
+atomic_int g_runtime_stop = 0;
+
+typedef struct {
+    const char *name;
+    int (*entry)(int, char **);
+    int argc;
+    char *argv[RUNTIME_MAX_ARGS + 1];
+    pthread_t tid;
+    int code; //return value of the main
+} Worker;
+
+static Worker g_workers[RUNTIME_MAX_WORKERS];
+static int g_num_workers = 0;
+
+static void *worker_thread(void *arg){
+    Worker *w = arg;
+
+    sigset_t all;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, NULL); //the blackboard reads the signals
+
+    w->code = w->entry(w->argc, w->argv);
+    return NULL;
+}
+
+int runtime_spawn(const char *name, int (*entry)(int, char **), int argc, char *argv[]){
+    if (g_num_workers >= RUNTIME_MAX_WORKERS || argc > RUNTIME_MAX_ARGS) return -1;
+
+    Worker *w = &g_workers[g_num_workers];
+    memset(w, 0, sizeof(*w));
+    w->name = name;
+    w->entry = entry;
+    w->argc = argc;
+    for (int i = 0; i < argc; i++) w->argv[i] = strdup(argv[i]); //the strings of the caller are on its stack
+    w->argv[argc] = NULL;
+
+    if (pthread_create(&w->tid, NULL, worker_thread, w) != 0) {
+        for (int i = 0; i < argc; i++) free(w->argv[i]);
+        return -1;
+    }
+    g_num_workers++;
+    return 0;
+}
+
+void runtime_stop(void){
+    atomic_store(&g_runtime_stop, 1);
+}
+
+void runtime_join(void){
+    runtime_stop();
+    for (int i = 0; i < g_num_workers; i++) {
+        Worker *w = &g_workers[i];
+        pthread_join(w->tid, NULL);
+        log_message("BLACKBOARD", "%s thread returned %d", w->name, w->code);
+        for (int j = 0; j < w->argc; j++) free(w->argv[j]);
+    }
+    g_num_workers = 0;
+}
+
+#endif
@@ -0,0 +1,141 @@
+/* this file contains the parallel shutdown of the children (shutdown.h)
+    - pidfd of every child in one epoll set, reaped in the order they exit
+    - SIGKILL only to the children still alive at the deadline
+    - fallback to waitpid(WNOHANG) when pidfd_open is not available
+*/
+
+#define _GNU_SOURCE
+
+#include <signal.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/wait.h>
+#include <sys/epoll.h>
+#include <sys/syscall.h>
+#include <stdint.h>
+
+#include "shutdown.h"
+#include "logger.h"
+
+#define SHUTDOWN_MAX 16
+#define SHUTDOWN_POLL_ms 10 //children without pidfd
+
+static long long mono_ms(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static int open_pidfd(pid_t pid){
+#ifdef SYS_pidfd_open
+    return (int)syscall(SYS_pidfd_open, pid, 0);
+#else
+    (void)pid;
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+//reap one child (1 if reaped, 0 if still running) and log how it ended
+static int reap(const ChildProc *c, int flags, long long elapsed_ms){
+    int status;
+    pid_t r = waitpid(c->pid, &status, flags);
+    if (r == 0) return 0;
+    if (r < 0) return 1; //already waited by someone else
+
+    if (WIFEXITED(status)) {
+        log_message("BLACKBOARD", "%s exited with code %d after %lldms", c->name, WEXITSTATUS(status), elapsed_ms);
+    } else if (WIFSIGNALED(status)) {
+        log_message("BLACKBOARD", "%s killed by signal %d after %lldms", c->name, WTERMSIG(status), elapsed_ms);
+    }
+    return 1;
+}
+
+int shutdown_children(const ChildProc *children, int num, int sig, int deadline_ms){
+    int fds[SHUTDOWN_MAX];
+    int alive[SHUTDOWN_MAX];
+    int left = 0, polled = 0, killed = 0;
+    if (num > SHUTDOWN_MAX) num = SHUTDOWN_MAX;
+
+    long long start = mono_ms();
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+
+    //signal everybody first, then wait: the children stop in parallel
+    for (int i = 0; i < num; i++) {
+        fds[i] = -1;
+        alive[i] = children[i].pid > 0;
+        if (!alive[i]) continue;
+
+        fds[i] = open_pidfd(children[i].pid);
+        if (fds[i] < 0 && errno == ESRCH) { //already reaped
+            alive[i] = 0;
+            continue;
+        }
+        if (sig) kill(children[i].pid, sig);
+
+        struct epoll_event ev = { .events = EPOLLIN, .data.u32 = (uint32_t)i };
+        if (fds[i] >= 0 && epfd >= 0 && epoll_ctl(epfd, EPOLL_CTL_ADD, fds[i], &ev) == 0) {
+            left++;
+        } else {
+            if (fds[i] >= 0) close(fds[i]);
+            fds[i] = -1;
+            polled++;
+        }
+    }
+
+    while (left + polled > 0) {
+        long long elapsed = mono_ms() - start;
+        long long remaining = deadline_ms - elapsed;
+        if (remaining <= 0) break;
+
+        if (polled > 0) { //children without pidfd
+            for (int i = 0; i < num; i++) {
+                if (alive[i] && fds[i] < 0 && reap(&children[i], WNOHANG, elapsed)) {
+                    alive[i] = 0;
+                    polled--;
+                }
+            }
+            if (remaining > SHUTDOWN_POLL_ms) remaining = SHUTDOWN_POLL_ms;
+        }
+        if (left == 0) {
+            if (polled > 0) {
+                struct timespec ts = {0, remaining * 1000000L};
+                nanosleep(&ts, NULL);
+            }
+            continue;
+        }
+
+        struct epoll_event out[SHUTDOWN_MAX];
+        int n = epoll_wait(epfd, out, SHUTDOWN_MAX, (int)remaining);
+        if (n < 0 && errno != EINTR) break;
+        for (int k = 0; k < n; k++) {
+            int i = (int)out[k].data.u32;
+            if (!alive[i]) continue;
+            reap(&children[i], 0, mono_ms() - start); //the pidfd is readable: the child is a zombie, no wait
+            alive[i] = 0;
+            epoll_ctl(epfd, EPOLL_CTL_DEL, fds[i], NULL);
+            left--;
+        }
+    }
+
+    //deadline: SIGKILL to who is still alive (the kernel ends it, the wait is bounded)
+    for (int i = 0; i < num; i++) {
+        if (!alive[i]) continue;
+        log_message("BLACKBOARD", "WARNING: %s still alive at the shutdown deadline (%dms), SIGKILL",
+                    children[i].name, deadline_ms);
+        kill(children[i].pid, SIGKILL);
+        reap(&children[i], 0, mono_ms() - start);
+        killed++;
+    }
+
+    for (int i = 0; i < num; i++) {
+        if (fds[i] >= 0) close(fds[i]);
+    }
+    if (epfd >= 0) close(epfd);
+
+    log_message("BLACKBOARD", "[SHUTDOWN] children stopped in %lldms (deadline %dms, %d killed)",
+                mono_ms() - start, deadline_ms, killed);
+    return killed;
+}
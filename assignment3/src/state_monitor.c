@@ -0,0 +1,102 @@
+/* this file contains the state monitor (make monitor)
+    - maps read-only the GameState snapshot published by the blackboard (state shm)
+    - prints one line every period: publications, physics ticks, age of the snapshot, drone and score
+    - never writes in the shm and never waits the blackboard (seqlock read), any number can run
+    - not a process of the game: no heartbeat slot, no log
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "state_shm.h"
+
+static volatile sig_atomic_t g_stop = 0; //Ctrl+C
+
+static void on_signal(int sig) {
+    (void)sig;
+    g_stop = 1;
+}
+
+//one line with the snapshot and the rates since the previous one
+static void print_snapshot(const StateSnapshot *s, const StateSnapshot *prev, uint64_t elapsed_us) {
+    const GameState *g = &s->gs;
+    double secs = elapsed_us / 1e6;
+    double pub_s = (prev && secs > 0) ? (s->tick - prev->tick) / secs : 0.0;
+    double tick_s = (prev && secs > 0) ? (s->physics_ticks - prev->physics_ticks) / secs : 0.0;
+    double age_ms = (now_us() - s->publish_us) / 1000.0;
+
+    printf("tick=%-8llu physics=%-8llu pub/s=%-6.1f phys/s=%-6.1f age=%7.2fms  drone=(%6.2f,%6.2f) v=(%5.2f,%5.2f)  "
+           "score=%-4d targets=%d/%d obst_hit=%d fence_hit=%d\n",
+           (unsigned long long)s->tick, (unsigned long long)s->physics_ticks, pub_s, tick_s, age_ms,
+           g->drone.x, g->drone.y, g->drone.vx, g->drone.vy,
+           g->score, g->current_target_index, g->total_targets, g->obstacles_hit_tot, g->fence_collision_tot);
+    fflush(stdout);
+}
+
+
+int main(int argc, char *argv[])
+{
+    /*optional args:
+        1. period in ms (default 500)
+        2. number of lines (default 0: until Ctrl+C or the end of the game)
+    */
+    if (argc > 1 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0)) {
+        printf("Usage: %s [period_ms] [count]\n", argv[0]);
+        return 0;
+    }
+    int period_ms = (argc > 1) ? atoi(argv[1]) : 500;
+    int count = (argc > 2) ? atoi(argv[2]) : 0;
+    if (period_ms <= 0) period_ms = 500;
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    //map the state snapshot (read-only)
+    int st_fd = shm_open(STATE_SHM_NAME, O_RDONLY, 0666);
+    if (st_fd < 0) {
+        fprintf(stderr, "state_monitor: %s not found (is the blackboard running?)\n", STATE_SHM_NAME);
+        return 1;
+    }
+    const StateShm *state = mmap(NULL, sizeof(StateShm), PROT_READ, MAP_SHARED, st_fd, 0);
+    close(st_fd);
+    if (state == MAP_FAILED) {
+        perror("state_monitor mmap");
+        return 1;
+    }
+
+    static StateSnapshot snap, prev; //static: the GameState is not small
+    int have_prev = 0;
+    uint64_t prev_us = 0;
+
+    struct timespec ts = { period_ms / 1000, (long)(period_ms % 1000) * 1000000L };
+
+    for (int n = 0; !g_stop && (count == 0 || n < count); n++) {
+        state_read(state, &snap);
+        uint64_t t = now_us();
+        print_snapshot(&snap, have_prev ? &prev : NULL, t - prev_us);
+
+        if (!snap.running) {
+            printf("blackboard stopped\n");
+            break;
+        }
+        prev = snap;
+        prev_us = t;
+        have_prev = 1;
+        nanosleep(&ts, NULL);
+    }
+
+    munmap((void *)state, sizeof(StateShm));
+    return 0;
+}
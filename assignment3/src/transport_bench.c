@@ -0,0 +1,142 @@
+/* this file contains the benchmark of the worker transports (make bench)
+    - a forked producer sends messages of the size of msgInput with its send time
+    - the consumer waits with epoll and drains all the messages at each wake-up, like the blackboard
+    - burst: messages per second with the producer always sending
+    - paced: one message every PERIOD us, latency from chan_send to the drain (p50/p99/max)
+    - same code for the pipe and for the shared memory ring + eventfd
+*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <sys/epoll.h>
+
+#include "transport.h"
+#include "perf.h"
+
+#define BENCH_RING "/ring_bench"
+
+typedef struct { //same size of msgInput
+    uint32_t seq;
+    uint64_t sent_us;
+} __attribute__((packed)) BenchMsg;
+
+//sleep until an absolute time (us)
+static void sleep_until(uint64_t t_us){
+    struct timespec ts = { (time_t)(t_us / 1000000ULL), (long)(t_us % 1000000ULL) * 1000L };
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+}
+
+//producer: 'count' messages, one every 'period_us' (0 = as fast as possible)
+static void produce(Channel *c, int count, uint64_t period_us){
+    uint64_t next = now_us();
+    for (int i = 0; i < count; i++) {
+        if (period_us) {
+            next += period_us;
+            sleep_until(next);
+        }
+        BenchMsg m = { (uint32_t)i, now_us() };
+        if (chan_send(c, &m, sizeof(m)) != sizeof(m)) {
+            perror("chan_send");
+            _exit(1);
+        }
+    }
+}
+
+//one run: fork the producer and read all the messages
+static void run(int ring, int count, uint64_t period_us){
+    Channel rx, tx;
+    int p[2];
+    if (pipe(p) < 0) {
+        perror("pipe");
+        exit(1);
+    }
+
+    static ChanBatch batch;
+    batch.len = batch.pos = 0;
+
+    if (ring) {
+        if (chan_create_ring(&rx, BENCH_RING) < 0) {
+            perror("ring");
+            exit(1);
+        }
+        tx = rx; //same mapping and eventfd after the fork
+    } else {
+        chan_pipe(&rx, p[0]);
+        chan_pipe(&tx, p[1]);
+    }
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        produce(&tx, count, period_us);
+        _exit(0);
+    }
+
+    chan_nonblock(&rx);
+    int epfd = epoll_create1(0);
+    struct epoll_event ev = { .events = EPOLLIN };
+    epoll_ctl(epfd, EPOLL_CTL_ADD, rx.fd, &ev);
+
+    PerfHist lat;
+    perf_reset(&lat);
+    uint64_t wakeups = 0;
+    uint64_t t0 = now_us();
+
+    for (int got = 0; got < count; ) {
+        struct epoll_event out;
+        int n = epoll_wait(epfd, &out, 1, 1000);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            fprintf(stderr, "timeout after %d messages\n", got);
+            break;
+        }
+        wakeups++;
+
+        if (chan_drain(&rx, &batch) < 0) {
+            fprintf(stderr, "channel closed after %d messages\n", got);
+            break;
+        }
+        BenchMsg m;
+        while (chan_batch_next(&batch, &m, sizeof(m))) {
+            perf_record(&lat, now_us() - m.sent_us);
+            got++;
+        }
+    }
+    uint64_t elapsed = now_us() - t0;
+    waitpid(pid, NULL, 0);
+
+    printf("%-5s %-6s msgs=%-7d %9.0f msg/s  wake-ups/msg=%.2f  latency p50<=%lluus p99<=%lluus max=%lluus\n",
+           ring ? "ring" : "pipe", period_us ? "paced" : "burst", count,
+           count * 1e6 / (double)elapsed, (double)wakeups / count,
+           (unsigned long long)perf_percentile(&lat, 50), (unsigned long long)perf_percentile(&lat, 99),
+           (unsigned long long)lat.max);
+
+    close(epfd);
+    close(p[0]);
+    close(p[1]);
+    if (ring) chan_close(&rx, 1);
+}
+
+
+int main(int argc, char *argv[])
+{
+    /*optional args:
+        1. messages of the burst run (default 200000)
+        2. period of the paced run in us (default 1000, 2000 messages)
+    */
+    int burst = (argc > 1) ? atoi(argv[1]) : 200000;
+    uint64_t period = (argc > 2) ? (uint64_t)atoll(argv[2]) : 1000;
+
+    for (int ring = 0; ring <= 1; ring++) {
+        run(ring, burst, 0);
+        run(ring, 2000, period);
+    }
+    return 0;
+}
@@ -1,9 +1,12 @@
 /* this file contains the function for the watchdog process
     - monitored all processes by the shared memory heartbeat table
     
-    - Every CHECK_INTERVAL_MS:
-        read last_seen_ms for each slot
-        compare with now_ms()
+    - one epoll set, no periodic polling:
+        pidfd of every registered process: readable as soon as the process exits (also if it is a zombie not reaped yet)
+        timerfd armed at the earliest heartbeat deadline (last_seen_ms + TIMEOUT_MS of the oldest slot):
+        the watchdog sleeps until a slot can actually expire, then reads the table again and re-arms the timer
+        SIGHUP and SIGTERM are blocked outside epoll_pwait (no lost wake-up)
+        without pidfd (old kernel) the pids are checked with kill(p, 0) every CHECK_INTERVAL_MS
 
     - IF not receive heartbeat updates for longer than TIMEOUT_MS:
         1. notifies the blackboard (SIGUSR1) then it call endwin()
@@ -14,9 +17,15 @@
         1. logs the event
         2. kills all remaining processes
         3. exits
+
+    - supervisor (--supervise, RESTART_WORKERS > 0): a worker that exits or times out does not stop the game
+        1. SIGKILL to a worker that timed out (hung: its restart replaces it)
+        2. releases its slot
+        3. HB_SIG_RESTART to the blackboard with the process of the slot: the blackboard starts it again alone
+        the blackboard itself is never restarted: its failure still kills all
  */
 
-#define _POSIX_C_SOURCE 200809L
+#define _GNU_SOURCE
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -28,11 +37,18 @@
 #include <errno.h>
 #include <time.h>
 #include <string.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/syscall.h>
+#include <sys/resource.h>
 
 #include "heartbeat.h"
 #include "logger.h"
+#include "runtime.h"
+#include "rt_profile.h"
 
-#define CHECK_INTERVAL_MS 10
+#define CHECK_INTERVAL_MS 10 //boot wait, processes without pidfd, stop flag of the threaded runtime
+#define WD_TAG_TIMER HB_MAX_SLOTS //epoll tag of the timerfd (the pidfds use their slot)
 
 //macro to print the heartbeat table (debug)
 #define LOG_PATH "logs/"
@@ -61,8 +77,9 @@ static void log_open(const char *name) {
 
 //SIGKILL to kill all processes after timeout
 static void kill_all(const HeartbeatTable *hb) {
-    for (int i = 0; i < HB_SLOTS; i++) {
-        pid_t p = hb->entries[i].pid;
+    int used = hb_used(hb);
+    for (int i = 0; i < used; i++) {
+        pid_t p = hb_active(hb, i) ? hb_pid(hb, i) : 0;
         if (p > 0 && p != getpid()) {
             kill(p, SIGKILL);
         }
@@ -71,37 +88,178 @@ static void kill_all(const HeartbeatTable *hb) {
 
 //used for the global SIGHUP
 static volatile sig_atomic_t g_sighup_received = 0;
+static volatile sig_atomic_t g_sigterm_received = 0; //stop from the blackboard: log the stats and exit
 
+#ifndef THREADED_RUNTIME
 static void on_sighup(int sig) {
     (void)sig;
     g_sighup_received = 1;
 }
 
+static void on_sigterm(int sig) {
+    (void)sig;
+    g_sigterm_received = 1;
+}
+#endif
+
+//process watched in a slot
+typedef struct {
+    pid_t pid; //pid of the slot when fd was opened (0: none)
+    int fd; //pidfd in the epoll set (-1: none, checked with kill)
+} Watched;
+
+typedef struct {
+    uint64_t start_ms;
+    unsigned long long wakeups;
+} WdStats;
+
+//name claimed with the slot (written before the slot became active)
+static const char *slot_name(const HeartbeatTable *hb, int i) {
+    return hb->entries[i].name;
+}
+
+//timeout of the slot: its own or the one of the watchdog
+static uint64_t slot_timeout(const HeartbeatTable *hb, int i, uint64_t timeout_ms) {
+    return hb->entries[i].timeout_ms ? hb->entries[i].timeout_ms : timeout_ms;
+}
+
+//stop watching the process of a slot (the pidfd leaves the epoll set when it is closed)
+static void unwatch(Watched *w, int *polled) {
+    if (w->pid > 0 && w->fd < 0 && w->pid != getpid()) (*polled)--;
+    if (w->fd >= 0) close(w->fd);
+    w->pid = 0;
+    w->fd = -1;
+}
+
+static int open_pidfd(pid_t pid) {
+#ifdef SYS_pidfd_open
+    return (int)syscall(SYS_pidfd_open, pid, 0);
+#else
+    (void)pid;
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+//open the pidfd of the slots claimed (or claimed again) since the last wake-up, return a slot already dead or -1
+//added: processes watched for the first time
+static int watch_pids(const HeartbeatTable *hb, int epfd, Watched *w, int *polled, uint64_t timeout_ms, int *added) {
+    int used = hb_used(hb);
+    for (int i = 0; i < used; i++) {
+        pid_t p = hb_active(hb, i) ? hb_pid(hb, i) : 0;
+        if (p == w[i].pid) continue;
+        unwatch(&w[i], polled);
+        w[i].pid = p;
+        if (p <= 0) continue; //slot free
+        (*added)++;
+        log_message("WATCHDOG", "Watching %s (slot=%d, PID=%d, period %ums, timeout %llums)", slot_name(hb, i), i, (int)p,
+                    hb->entries[i].period_ms, (unsigned long long)slot_timeout(hb, i, timeout_ms));
+        if (p == getpid()) continue; //threaded runtime: the workers are threads of this process
+
+        int fd = open_pidfd(p);
+        if (fd < 0 && errno == ESRCH) return i;
+        struct epoll_event ev = { .events = EPOLLIN, .data.u32 = (uint32_t)i };
+        if (fd >= 0 && epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) == 0) {
+            w[i].fd = fd;
+        } else {
+            if (fd >= 0) close(fd);
+            (*polled)++;
+        }
+    }
+    return -1;
+}
 
-int main(int argc, char **argv) {
+//processes without pidfd: a dead slot or -1 (a zombie not reaped yet still answers to kill)
+static int poll_pids(const Watched *w) {
+    for (int i = 0; i < HB_MAX_SLOTS; i++) {
+        if (w[i].pid > 0 && w[i].fd < 0 && w[i].pid != getpid() && kill(w[i].pid, 0) == -1 && errno == ESRCH) return i;
+    }
+    return -1;
+}
+
+//supervisor: release the slot of a failed worker and ask the blackboard to restart it (0: not possible, kill all)
+static int request_restart(HeartbeatTable *hb, int slot, Watched *w, int *polled, int hung) {
+    pid_t bb = hb_pid(hb, HB_SLOT_BLACKBOARD);
+    pid_t p = hb_pid(hb, slot);
+    if (slot == HB_SLOT_BLACKBOARD || bb <= 0 || p == getpid()) return 0;
+
+    char name[HB_NAME_LEN];
+    snprintf(name, sizeof(name), "%s", slot_name(hb, slot)); //the slot can be claimed again after the release
+    int proc = hb_proc_of(name);
+
+    if (hung && p > 0) kill(p, SIGKILL); //stopped or deadlocked: it must not come back next to its restart
+    unwatch(&w[slot], polled);
+    hb_release(hb, slot);
+
+    if (proc < 0) { //not started by the blackboard: nothing to restart
+        log_message("WATCHDOG", "%s (slot=%d, PID=%d) not started by the blackboard, slot released", name, slot, (int)p);
+        return 1;
+    }
+    union sigval value = { .sival_int = proc };
+    if (sigqueue(bb, HB_SIG_RESTART, value) < 0) return 0;
+    log_message("WATCHDOG", "%s (slot=%d, PID=%d) %s: slot released, restart requested", name, slot, (int)p,
+                hung ? "killed" : "exited");
+    LOGF(LOG_PATH "watchdog.log", "%s PID %d released, restart requested to the blackboard (PID %d)\n", name, (int)p, (int)bb);
+    return 1;
+}
+
+//200 ms for the endwin() of the blackboard after SIGUSR1, with SIGTERM unblocked:
+//the blackboard answers stopping the watchdog (SIGTERM) and then the others, the sleep ends early
+static void endwin_delay(const sigset_t *wait_mask) {
+    if (wait_mask) sigprocmask(SIG_SETMASK, wait_mask, NULL);
+    struct timespec ts_edwin;
+    ts_edwin.tv_sec = 0;
+    ts_edwin.tv_nsec = 200 * 1000 * 1000; // 200 ms
+    if (!g_sigterm_received) nanosleep(&ts_edwin, NULL);
+}
+
+//cpu time and wake-ups of the monitoring loop (the cost of the watchdog)
+static void log_stats(const WdStats *st) {
+    struct rusage ru;
+#ifdef RUSAGE_THREAD
+    getrusage(RUSAGE_THREAD, &ru); //threaded runtime: only the watchdog thread
+#else
+    getrusage(RUSAGE_SELF, &ru);
+#endif
+    double cpu_ms = ru.ru_utime.tv_sec * 1e3 + ru.ru_utime.tv_usec / 1e3 + ru.ru_stime.tv_sec * 1e3 + ru.ru_stime.tv_usec / 1e3;
+    double secs = (now_ms() - st->start_ms) / 1000.0;
+    log_message("WATCHDOG", "[PERF] %llu wake-ups in %.1fs (%.1f/s), cpu %.1fms", st->wakeups, secs,
+                secs > 0 ? st->wakeups / secs : 0.0, cpu_ms);
+}
+
+
+int WORKER_MAIN(watchdog)(int argc, char **argv) {
     
     if (argc <3) {
         /* args:
             1. argv[1] = shm_name  ('/heartbeat')
             2. argv[2] = timeout_ms ('2000')
+            3. optional: '--supervise' (the blackboard restarts a failed worker)
         */
-        fprintf(stderr, "Usage: %s <shm_name> <timeout_ms>\n", argv[0]);
+        fprintf(stderr, "Usage: %s <shm_name> <timeout_ms> [--supervise]\n", argv[0]);
         return 1;
     }
 
     //read the argvs
     const char *shm_name = argv[1];
     uint64_t timeout_ms = (uint64_t)strtoull(argv[2], NULL, 10);
+    int supervise = (argc > 3 && strcmp(argv[3], "--supervise") == 0);
 
-    log_message("WATCHDOG", "Watchdog awakes (timeout: %llums)", (unsigned long long)timeout_ms);
+    log_message("WATCHDOG", "Watchdog awakes (timeout: %llums, %s)", (unsigned long long)timeout_ms,
+                supervise ? "failed workers restarted" : "a failure stops all");
+    rt_mlock_from_env("WATCHDOG"); //MLOCKALL=1 (the lock is not kept by exec)
 
     register_process("WATCHDOG"); //register watchdog pid in the pid file
 
+#ifndef THREADED_RUNTIME //threads: the blackboard reads SIGHUP
     //save handler to SIGHUP
     struct sigaction sa_hup;
     memset(&sa_hup, 0, sizeof(sa_hup));
     sa_hup.sa_handler = on_sighup;
     sigaction(SIGHUP, &sa_hup, NULL);
+    sa_hup.sa_handler = on_sigterm;
+    sigaction(SIGTERM, &sa_hup, NULL);
+#endif
 
     //open shared memory created by blackboard
     int hb_fd = shm_open(shm_name, O_RDWR, 0666);
@@ -117,24 +275,67 @@ int main(int argc, char **argv) {
         close(hb_fd); 
         return 1; 
     }
+    if (!hb_layout_ok(hb, "watchdog")) { //table of a build with another layout
+        log_message("WATCHDOG", "ERROR: heartbeat table layout %u, expected %u", hb->layout, HB_LAYOUT_VERSION);
+        munmap(hb, sizeof(*hb));
+        close(hb_fd);
+        return 1;
+    }
     log_message("WATCHDOG", "Heartbeat table mapped successfully");
 
-    //waiting for all process to wake up
-    struct timespec grace_ts;
-    grace_ts.tv_sec = 0;
-    grace_ts.tv_nsec = 300 * 1000 * 1000; // 300 ms
-    nanosleep(&grace_ts, NULL);
-    log_message("WATCHDOG", "All processes should be awake");
+    //waiting for all process to wake up: the blackboard writes boot_mask after its readiness barrier
+    struct timespec boot_ts = {0, CHECK_INTERVAL_MS * 1000 * 1000};
+    uint64_t boot_start = now_ms();
+    while (atomic_load(&hb->boot_mask) == 0 && runtime_running() && !g_sigterm_received &&
+           now_ms() - boot_start < timeout_ms * 4) {
+        runtime_sleep(&boot_ts);
+    }
+    log_message("WATCHDOG", "Processes ready after %llums (slots 0x%x)", (unsigned long long)(now_ms() - boot_start),
+                (unsigned)atomic_load(&hb->ready_mask));
+
+    //the signals wake up only epoll_pwait: a signal between the checks and the wait is not lost
+    sigset_t *wait_mask = NULL;
+#ifndef THREADED_RUNTIME //threads: all the signals are already blocked
+    sigset_t block, unblocked;
+    sigemptyset(&block);
+    sigaddset(&block, SIGHUP);
+    sigaddset(&block, SIGTERM);
+    sigprocmask(SIG_BLOCK, &block, &unblocked);
+    wait_mask = &unblocked;
+#endif
 
-    //use to pass the correct parameters to the timeout
-    int detected_slot = -1; 
-    pid_t detected_pid = -1;
+    //epoll set: one pidfd for each registered process + the timerfd of the earliest heartbeat deadline
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    int tfd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (epfd < 0 || tfd < 0) {
+        log_message("WATCHDOG", "ERROR: epoll/timerfd failed");
+        if (epfd >= 0) close(epfd);
+        if (tfd >= 0) close(tfd);
+        munmap(hb, sizeof(*hb));
+        close(hb_fd);
+        return 1;
+    }
+    struct epoll_event tev = { .events = EPOLLIN, .data.u32 = WD_TAG_TIMER };
+    epoll_ctl(epfd, EPOLL_CTL_ADD, tfd, &tev);
+
+    Watched watched[HB_MAX_SLOTS];
+    for (int i = 0; i < HB_MAX_SLOTS; i++) {
+        watched[i].pid = 0;
+        watched[i].fd = -1;
+    }
+    int polled = 0; //processes without pidfd: kill(p, 0) every CHECK_INTERVAL_MS
+
+    WdStats stats = { now_ms(), 0 };
+    int dead_slot = -1; //slot of a process that exited
+    int restarts_pending = 0; //restarts requested and not claimed yet: the table is read every CHECK_INTERVAL_MS
+    uint64_t restart_deadline = 0;
+    int reason = 0; //2: timeout, 3: process terminated or SIGHUP, 0: stopped
 
     #ifdef DEBUG //to print the heartbeat table in the watchdog.log
     static uint64_t last_log_ms = 0;
     #endif
 
-    while (1) { //monitoring loop
+    while (runtime_running() && !g_sigterm_received) { //monitoring loop
         uint64_t now = now_ms();
 
         #ifdef DEBUG //to print the 'slot set'
@@ -142,51 +343,47 @@ int main(int argc, char **argv) {
             if (do_log) last_log_ms = now;
         #endif
 
+        //pidfd of the processes registered since the last wake-up (a dead process is found here if pidfd is not available)
+        int added = 0;
+        if (dead_slot < 0) dead_slot = watch_pids(hb, epfd, watched, &polled, timeout_ms, &added);
+        restarts_pending = (added >= restarts_pending || now >= restart_deadline) ? 0 : restarts_pending - added;
+
         //check if the processes still exist
-        for (int i = 0; i < HB_SLOTS; i++) {
-            sem_wait(&hb->mutex); //lock the heartbeat table
-            pid_t p = hb->entries[i].pid;
-            sem_post(&hb->mutex); //unlock the heartbeat table
-
-            if (p <= 0) continue; //not registered processes
-
-            //check if the i-th process is still active
-            if (kill(p, 0) == -1 && errno == ESRCH) { //process does not exist 
-                const char *proc_name = "UNKNOWN";
-                if (i == HB_SLOT_BLACKBOARD) proc_name = "BLACKBOARD";
-                else if (i == HB_SLOT_INPUT) proc_name = "INPUT";
-                else if (i == HB_SLOT_DRONE) proc_name = "DRONE";
-                else if (i == HB_SLOT_TARGETS) proc_name = "TARGETS";
-                else if (i == HB_SLOT_OBSTACLES) proc_name = "OBSTACLES";
-                
-                log_message("WATCHDOG", "%s process (slot=%d, PID=%d) no longer exists, killing all processes", 
-                            proc_name, i, (int)p);
-                LOGF(LOG_PATH "watchdog.log", "%s PID %d not found (ESRCH), killing all\n", proc_name, (int)p);
-                
-                //notify blackboard before killing all
-                pid_t bb = hb->entries[HB_SLOT_BLACKBOARD].pid;
-                if (bb > 0 && i != HB_SLOT_BLACKBOARD) {
-                    LOGF(LOG_PATH "watchdog.log", "Sending SIGUSR1 to blackboard (PID %d)\n", (int)bb);
-                    kill(bb, SIGUSR1);
-                    
-                    //delay for endwin()
-                    struct timespec ts_edwin;
-                    ts_edwin.tv_sec = 0;
-                    ts_edwin.tv_nsec = 200 * 1000 * 1000; // 200 ms
-                    nanosleep(&ts_edwin, NULL);
-                }
+        if (dead_slot >= 0) {
+            const char *proc_name = slot_name(hb, dead_slot);
+            pid_t p = watched[dead_slot].pid;
+
+            log_message("WATCHDOG", "%s exit detected %llums after its last heartbeat", proc_name,
+                        (unsigned long long)(now - hb_last_seen(hb, dead_slot)));
+            if (supervise && request_restart(hb, dead_slot, watched, &polled, 0)) {
+                restarts_pending++;
+                restart_deadline = now + timeout_ms;
+                dead_slot = -1;
+                continue;
+            }
+            log_message("WATCHDOG", "%s process (slot=%d, PID=%d) no longer exists, killing all processes", 
+                        proc_name, dead_slot, (int)p);
+            LOGF(LOG_PATH "watchdog.log", "%s PID %d exited (pidfd), killing all\n", proc_name, (int)p);
+            
+            //notify blackboard before killing all
+            pid_t bb = hb_pid(hb, HB_SLOT_BLACKBOARD);
+            if (bb > 0 && dead_slot != HB_SLOT_BLACKBOARD) {
+                LOGF(LOG_PATH "watchdog.log", "Sending SIGUSR1 to blackboard (PID %d)\n", (int)bb);
+                kill(bb, SIGUSR1);
                 
-                kill_all(hb);
-                munmap(hb, sizeof(*hb));
-                close(hb_fd);
-                log_message("WATCHDOG", "Watchdog shutdown (reason: process %s terminated)", proc_name);
-                return 3; //exit code (against the '2' of timeout)
+                //delay for endwin()
+                endwin_delay(wait_mask);
             }
+            
+            if (!g_sigterm_received) kill_all(hb);
+            log_message("WATCHDOG", "Watchdog shutdown (reason: process %s terminated)", proc_name);
+            reason = 3; //exit code (against the '2' of timeout)
+            break;
         }
 
         //close widow after the SIGHUP is received
         if (g_sighup_received) {
-            pid_t bb_pid = hb->entries[HB_SLOT_BLACKBOARD].pid; //check if blackboard still active
+            pid_t bb_pid = hb_pid(hb, HB_SLOT_BLACKBOARD); //check if blackboard still active
             
             //if SIGHUP follow blackboard kill
             if (bb_pid > 0 && kill(bb_pid, 0) == -1 && errno == ESRCH) { //SIGHUP follows the blackboard kill
@@ -198,57 +395,56 @@ int main(int argc, char **argv) {
             }
             
             kill_all(hb);
-            munmap(hb, sizeof(*hb));
-            close(hb_fd);
             log_message("WATCHDOG", "Watchdog shutdown (reason: SIGHUP)");
-            return 3; 
+            reason = 3;
+            break;
         }
 
-        for (int i = 0; i < HB_SLOTS; i++) { //create the heartbeat table
-            sem_wait(&hb->mutex); //lock the heartbeat table
-            pid_t p = hb->entries[i].pid;
-            uint64_t last = hb->entries[i].last_seen_ms;
-            sem_post(&hb->mutex); //unlock the heartbeat table
+        uint64_t deadline = UINT64_MAX; //earliest time a slot can expire
+        int used = hb_used(hb);
+        for (int i = 0; i < used; i++) { //create the heartbeat table
+            if (!hb_active(hb, i)) continue; //free slot or claim in progress
+            pid_t p = hb_pid(hb, i); //no lock: every slot is written only by its process
+            uint64_t last = hb_last_seen(hb, i);
+            uint64_t limit = slot_timeout(hb, i, timeout_ms);
 
-            //if the PID is not register continue -> possibility: process not started yet
+            //if the PID is not register continue
             if (p <= 0) continue;
 
-            //process registered but has not heartbeated yet -> wait
-            if (last == 0) continue;
-
             //no overflow: last>now
             if (last > now) {
                 LOGF(LOG_PATH "watchdog.log", 
                      "WARNING: slot=%d has future timestamp (last=%llu > now=%llu), resetting\n",
                      i, (unsigned long long)last, (unsigned long long)now);
                 
-                sem_wait(&hb->mutex); //lock the heartbeat table
-                hb->entries[i].last_seen_ms = now; // Reset timestamp
-                sem_post(&hb->mutex); //unlock the heartbeat table
-                
-                continue;
+                atomic_compare_exchange_strong(&hb->entries[i].last_seen_ms, &last, now); // Reset timestamp (not a newer heartbeat)
+                last = now;
             }
 
             //check the time before the last heartbeat
             uint64_t elapsed = now - last;
-            if (elapsed > timeout_ms) {
-                detected_slot = i;
-                detected_pid = p;
-
-                log_message("WATCHDOG", "TIMEOUT: slot=%d pid=%d (last seen %llums ago)",
-                            detected_slot, (int)detected_pid, (unsigned long long)elapsed);
+            if (elapsed > limit) {
+                log_message("WATCHDOG", "TIMEOUT: %s slot=%d pid=%d (last seen %llums ago, timeout %llums)",
+                            slot_name(hb, i), i, (int)p, (unsigned long long)elapsed, (unsigned long long)limit);
                 LOGF(LOG_PATH "watchdog.log", "watchdog msg: TIMEOUT slot=%d pid=%d last=%llums ago\n",
                     i, (int)p, (unsigned long long)elapsed); //print in the watchdog.log (to learn more about the watchdog activity)
+                if (supervise && request_restart(hb, i, watched, &polled, 1)) {
+                    restarts_pending++;
+                    restart_deadline = now + timeout_ms;
+                    continue;
+                }
                 
-                goto timeout;
+                reason = 2;
+                break;
             }
+            if (last + limit + 1 < deadline) deadline = last + limit + 1; //first ms with elapsed > timeout
 
             //DEBUG - print table    
             #ifdef DEBUG
             if (do_log) {
                 LOGF(LOG_PATH "watchdog.log",
-                    "slot=%d pid=%d last=%llu now=%llu diff=%llu\n",
-                    i, (int)p,
+                    "slot=%d name=%s pid=%d last=%llu now=%llu diff=%llu\n",
+                    i, slot_name(hb, i), (int)p,
                     (unsigned long long)last,
                     (unsigned long long)now,
                     (unsigned long long)(now - last));
@@ -256,37 +452,72 @@ int main(int argc, char **argv) {
             #endif
 
         }
+        if (reason == 2) { //timeout
+            //cleanup ncurses window (blackboard) before killing the process
+            pid_t bb = hb_pid(hb, HB_SLOT_BLACKBOARD);
+            if (bb > 0) { //registered processes
+                LOGF(LOG_PATH "watchdog.log", "watchdog sending SIGUSR1 to blackboard (PID %d)\n", (int)bb); //to learn more about the watchdog (check if bb_pid == detected_pid)
+                kill(bb, SIGUSR1);
+            }
 
-        //used for the 'nanosleep' function
-        struct timespec ts_check;
-        ts_check.tv_sec = 0;
-        ts_check.tv_nsec = CHECK_INTERVAL_MS * 1000 * 1000; //ms -> ns
-        nanosleep(&ts_check, NULL);
-        continue;
-
+            //delay for the edwin()
+            endwin_delay(wait_mask);
 
-timeout:
-        //cleanup ncurses window (blackboard) before killing the process
-        pid_t bb = hb->entries[HB_SLOT_BLACKBOARD].pid;
-        if (bb > 0) { //registered processes
-            LOGF(LOG_PATH "watchdog.log", "watchdog sending SIGUSR1 to blackboard (PID %d)\n", (int)bb); //to learn more about the watchdog (check if bb_pid == detected_pid)
-            kill(bb, SIGUSR1);
+            //kill all registered processe (the blackboard did not stop them itself)
+            if (!g_sigterm_received) kill_all(hb);
+            log_message("WATCHDOG", "Killes all processes, watchdog shutdown (reason: timeout)");
+            break;
         }
 
-        //delay for the edwin() - used for the 'nanosleep' function
-        struct timespec ts_edwin;
-        ts_edwin.tv_sec = 0;
-        ts_edwin.tv_nsec = 200 * 1000 * 1000; // 200 ms
-        nanosleep(&ts_edwin, NULL);
-
-        //kill all registered processe  
-        kill_all(hb);
-
-        munmap(hb, sizeof(*hb));
-        close(hb_fd);
-
-        log_message("WATCHDOG", "Killes all processes, watchdog shutdown (reason: timeout)");
+        //sleep until a heartbeat can expire or a process exits
+        if (deadline == UINT64_MAX) deadline = now + timeout_ms; //nothing registered yet
+        struct itimerspec its;
+        memset(&its, 0, sizeof(its));
+        its.it_value.tv_sec = (time_t)(deadline / 1000);
+        its.it_value.tv_nsec = (long)(deadline % 1000) * 1000000L;
+        timerfd_settime(tfd, TFD_TIMER_ABSTIME, &its, NULL);
+
+        int wait_ms = -1;
+#ifdef THREADED_RUNTIME
+        wait_ms = CHECK_INTERVAL_MS; //stop flag of the runtime
+#endif
+        if (polled > 0 || restarts_pending > 0) wait_ms = CHECK_INTERVAL_MS; //the new process is watched as soon as it claims
+
+        struct epoll_event evs[HB_MAX_SLOTS + 1];
+        int n = epoll_pwait(epfd, evs, HB_MAX_SLOTS + 1, wait_ms, wait_mask); //SIGHUP and SIGTERM only here
+        stats.wakeups++;
+#ifndef THREADED_RUNTIME
+        //a signal sent before an exit stays pending when epoll_pwait returns the pidfd: the blackboard is stopping us
+        sigset_t pending;
+        if (n > 0 && sigpending(&pending) == 0) {
+            if (sigismember(&pending, SIGTERM)) g_sigterm_received = 1;
+            if (sigismember(&pending, SIGHUP)) g_sighup_received = 1;
+        }
+#endif
+        for (int k = 0; k < n; k++) {
+            uint32_t tag = evs[k].data.u32;
+            if (tag == WD_TAG_TIMER) {
+                uint64_t expirations;
+                if (read(tfd, &expirations, sizeof(expirations)) < 0) { /* already read */ }
+            } else if (tag < HB_MAX_SLOTS) {
+                if (hb_active(hb, (int)tag) && watched[tag].pid == hb_pid(hb, (int)tag)) dead_slot = (int)tag;
+                else unwatch(&watched[tag], &polled); //slot freed or claimed again: watched again at the next scan
+            }
+        }
+        if (polled > 0 && dead_slot < 0) dead_slot = poll_pids(watched);
+    }
 
-        return 2;
+    log_stats(&stats);
+    for (int i = 0; i < HB_MAX_SLOTS; i++) {
+        if (watched[i].fd >= 0) close(watched[i].fd);
     }
+    close(tfd);
+    close(epfd);
+    munmap(hb, sizeof(*hb));
+    close(hb_fd);
+    if (reason) return reason;
+
+    //threaded runtime or SIGTERM: stopped by the blackboard
+    log_message("WATCHDOG", "Watchdog shutdown (reason: blackboard stop)");
+    return 0;
 }
@@ -49,6 +49,7 @@ void respawn_obstacle(GameState *g, int i) {
     //if the position is free we can save it for the obstacle i-th
     g->obstacles[i].x = ox;
     g->obstacles[i].y = oy;
+    g->obstacles_rev++; //the camera rebuilds its index
 }
 
 